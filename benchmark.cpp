@@ -0,0 +1,651 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sketch/modes.h"
+#include "sketch/engine.h"
+#include "sketch/output.h"
+#include "sketch/palettes.h"
+#include "sketch/presets.h"
+#include "sketch/gradients.h"
+#include "sketch/perlin.h"
+#include "sketch/timing.h"
+#include "sketch/pipeline.h"
+#include "sketch/workers.h"
+
+// Headless benchmarks for the rendering kernels, output as CSV
+//  ./benchmark.exe modes [frames]  Every mode against every palette at several strip lengths
+//  ./benchmark.exe stages [frames] Time split between the stages of updateStrip() for every mode
+//  ./benchmark.exe pipeline [frames] Three strips rendered then sent in turn, against the pipelined render and output
+//  ./benchmark.exe workers [frames] Eight strips rendered one after another, against spread over a worker pool
+//  ./benchmark.exe noise [frames]  Per pixel Perlin noise against the batched row
+//  ./benchmark.exe palettes [frames] Time to rebuild each palette's lut, which happens whenever its colours change
+//  ./benchmark.exe presets [frames] Preset luts rebuilt from the formulas against the compile time tables, and the tables' error
+//  ./benchmark.exe chains [frames] Luts filled through multi stop blends with a blend function pointer, against the template stop chains
+//  ./benchmark.exe gamma [frames]  The gamma and dimmer table against powf over every 12 bit input, checked to within one count
+//  ./benchmark.exe fused [frames]  Output bytes from the staged palette and gamma path against the fused kernel, checked to match
+//  ./benchmark.exe fixed [frames] [file] Every mode and palette rendered with float pixels against Q0.16. A PIXEL_FIXED_POINT build
+//                                  writes its renders to file, a float build compares against them (run-benchmark.sh does both)
+//  ./benchmark.exe list            Every mode and what it relies on
+
+static const uint8_t paletteFamilies[] = { 0, 10, 20, 30, 40, 50, 60, 70, 100, 110, 120 }; // Each has variants 0-8
+static const uint8_t presetPalettes[] = { 240, 241, 242, 243, 244, 245 };
+static const uint16_t lengths[] = { 60, 300, 1000, 4000 };
+static const uint64_t frameTimeUs = 10000; // Fixed time source, so every run renders exactly the same frames
+
+static volatile float sink; // Stops the compiler optimising away the work being timed
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Deterministic control movement so the modes have something to do each frame
+static void animateControls(Controls& controls, int frame) {
+  controls.control = (float)((frame * 7) % 256) / 255.0f;
+  controls.smooth = (float)((frame * 3) % 256) / 255.0f;
+}
+
+static void benchModePalette(PixelStrip& strip, uint8_t mode, uint8_t palette, int frames) {
+  Controls controls(Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f));
+  controls.mode = mode;
+  controls.palette = palette;
+  strip.random.seed(1);
+  uint64_t timeUs = 0;
+  int warmup = 5;
+  for (int f=0; f<warmup; f++) {
+    animateControls(controls, f);
+    timeUs += frameTimeUs;
+    updateStrip(controls, strip, timeUs);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) {
+    animateControls(controls, warmup + f);
+    timeUs += frameTimeUs;
+    updateStrip(controls, strip, timeUs);
+  }
+  double frameNs = elapsedNs(start) / (double)frames;
+  sink = strip.output[0];
+  printf("%d,%d,%d,%.2f,%.1f\n", mode, palette, strip.length, frameNs / strip.length, 1.0e9 / frameNs);
+}
+
+static void benchModes(int frames) {
+  setOutputLevels(0.0f, 0.0f);
+  printf("mode,palette,length,ns_per_pixel,fps\n");
+  for (uint16_t length : lengths) {
+    PixelStrip strip(length, LayoutGrbw);
+    strip.output = new uint8_t[length*4];
+    for (uint8_t m=0; m<modeCount; m++) {
+      uint8_t mode = modeTable[m].id;
+      for (uint8_t family : paletteFamilies) {
+        for (uint8_t variant=0; variant<=8; variant++) { benchModePalette(strip, mode, family + variant, frames); }
+      }
+      for (uint8_t palette : presetPalettes) { benchModePalette(strip, mode, palette, frames); }
+    }
+    delete[] strip.output;
+    fflush(stdout);
+  }
+}
+
+static void benchStages(int frames) {
+  setOutputLevels(0.0f, 0.0f);
+  printf("mode,length,stage,min_us,avg_us,p99_us\n");
+  for (uint16_t length : lengths) {
+    PixelStrip strip(length, LayoutGrbw);
+    strip.output = new uint8_t[length*4];
+    for (uint8_t m=0; m<modeCount; m++) {
+      uint8_t mode = modeTable[m].id;
+      Controls controls(Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f));
+      controls.mode = mode;
+      strip.random.seed(1);
+      uint64_t timeUs = 0;
+      resetTiming();
+      for (int f=0; f<frames; f++) {
+        animateControls(controls, f);
+        timeUs += frameTimeUs;
+        updateStrip(controls, strip, timeUs);
+      }
+      for (uint8_t stage=0; stage<stageCount; stage++) {
+        TimingSummary summary;
+        if (!timingSummary(strip.index, (Stage)stage, summary)) { continue; }
+        printf("%d,%d,%s,%.2f,%.2f,%.2f\n", mode, length, stageName((Stage)stage), summary.min, summary.avg, summary.p99);
+      }
+    }
+    delete[] strip.output;
+    fflush(stdout);
+  }
+}
+
+// Stands in for Show(), which takes as long as the bits take to clock out. 32 bits at 800kHz per SK6812 pixel,
+// and the parallel outputs all send at once so it's the length of one strip
+static void simulateShow (const uint8_t*, void* context) {
+  uint16_t length = *(uint16_t*)context;
+  std::this_thread::sleep_for(std::chrono::microseconds(length * 40));
+}
+
+static void renderStrips (PixelStrip** strips, Controls& controls, uint8_t* frame, uint64_t timeUs) {
+  for (uint8_t s=0; s<3; s++) {
+    strips[s]->output = frame + s * strips[s]->length * 4;
+    updateStrip(controls, *strips[s], timeUs);
+  }
+}
+
+static void benchPipeline(int frames) {
+  setOutputLevels(0.0f, 0.0f);
+  printf("length,serial_fps,pipelined_fps\n");
+  for (uint16_t length : lengths) {
+    PixelStrip* strips[3];
+    for (uint8_t s=0; s<3; s++) { strips[s] = new PixelStrip(length, LayoutGrbw); strips[s]->setIndex(s); }
+    Controls controls(Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f));
+    controls.mode = 20;
+    uint64_t timeUs = 0;
+
+    uint8_t* frame = new uint8_t[3 * length * 4];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int f=0; f<frames; f++) {
+      timeUs += frameTimeUs;
+      renderStrips(strips, controls, frame, timeUs);
+      simulateShow(frame, &length);
+    }
+    double serialFps = frames * 1.0e9 / elapsedNs(start);
+
+    FramePipeline pipeline(3 * length * 4);
+    startOutputTask(pipeline, simulateShow, &length);
+    start = std::chrono::steady_clock::now();
+    for (int f=0; f<frames; f++) {
+      timeUs += frameTimeUs;
+      renderStrips(strips, controls, pipeline.beginRender(), timeUs);
+      pipeline.endRender();
+    }
+    stopOutputTask(pipeline); // Drains the frames still queued
+    double pipelinedFps = frames * 1.0e9 / elapsedNs(start);
+
+    printf("%d,%.1f,%.1f\n", length, serialFps, pipelinedFps);
+    fflush(stdout);
+    for (uint8_t s=0; s<3; s++) { delete strips[s]; }
+    delete[] frame;
+  }
+}
+
+// Eight strips through the same engine the sketch uses, first with no workers so render() runs them one after
+// another, then across the pool
+static void benchWorkers(int frames) {
+  uint8_t workers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1;
+  if (workers > maxWorkers) { workers = maxWorkers; }
+  setOutputLevels(0.0f, 0.0f);
+  printf("length,strips,workers,serial_us,parallel_us\n");
+  for (uint16_t length : lengths) {
+    StripConfig configs[maxStrips];
+    for (uint8_t s=0; s<maxStrips; s++) { configs[s] = { 0, length, dmxStripChannels, Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f), false }; }
+    StripEngine engine(configs, maxStrips, LayoutGrbw);
+    uint8_t* frame = new uint8_t[engine.outputBytes];
+    engine.setOutputFrame(frame);
+    for (uint8_t s=0; s<engine.count; s++) { engine.controls[s].mode = 20; }
+    uint64_t timeUs = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int f=0; f<frames; f++) {
+      timeUs += frameTimeUs;
+      engine.render(timeUs);
+    }
+    double serialUs = elapsedNs(start) / 1000.0 / frames;
+
+    startWorkers(workers);
+    start = std::chrono::steady_clock::now();
+    for (int f=0; f<frames; f++) {
+      timeUs += frameTimeUs;
+      engine.render(timeUs);
+    }
+    double parallelUs = elapsedNs(start) / 1000.0 / frames;
+    stopWorkers();
+
+    printf("%d,%d,%d,%.1f,%.1f\n", length, engine.count, workers, serialUs, parallelUs);
+    fflush(stdout);
+    delete[] frame;
+  }
+}
+
+// Perlin noise as noiseMode uses it: 4 octaves along a strip, comparing per pixel calls with the batched row
+static void benchNoise(int length, int frames) {
+  float* out = new float[length];
+  float dx = 4.0f / (float)(length-1);
+  float total = 0.0f;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) {
+    float y = (float)f * 0.01f;
+    for (int i=0; i<length; i++) { out[i] = perlin_octaves(0.5f + dx*i, y, 4, 0.5f, 2.0f); }
+    total += out[length/2];
+  }
+  double perPixelNs = elapsedNs(start) / ((double)frames * length);
+
+  start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) {
+    float y = (float)f * 0.01f;
+    perlin_octaves_row(0.5f, dx, y, 4, 0.5f, 2.0f, out, length);
+    total += out[length/2];
+  }
+  double rowNs = elapsedNs(start) / ((double)frames * length);
+
+  sink = total;
+  printf("noise,%d,%.2f,%.2f\n", length, perPixelNs, rowNs);
+  delete[] out;
+}
+
+static void benchPaletteLut(uint8_t palette, int frames) {
+  PaletteEntry entries[paletteLutSize+1];
+  PaletteLut lut;
+  lut.entries = entries;
+  Rgb back(0.1f, 0.2f, 0.6f);
+  Rgb fores[2] = { Rgb(0.9f, 0.5f, 0.1f), Rgb(0.8f, 0.6f, 0.2f) }; // Alternated so every call rebuilds
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) { updatePaletteLut(lut, palette, back, fores[f & 1]); }
+  double rebuildUs = elapsedNs(start) / 1000.0 / frames;
+  sink = entries[paletteLutSize/2].red;
+  printf("%d,%.2f\n", palette, rebuildUs);
+}
+
+static void benchPalettes(int frames) {
+  printf("palette,rebuild_us\n");
+  for (uint8_t family : paletteFamilies) {
+    for (uint8_t variant=0; variant<=8; variant++) { benchPaletteLut(family + variant, frames); }
+  }
+  for (uint8_t palette : presetPalettes) { benchPaletteLut(palette, frames); }
+  setGradient(0, "0:000000 64:ff0000:h 128:ffff00:o 192:00ffff:s 224:0000ff 255:ffffff");
+  benchPaletteLut(gradientFirst, frames);
+}
+
+static float maxChannelDiff(const Rgb& a, const Rgb& b) {
+  return std::max(std::fabs(a.red - b.red), std::max(std::fabs(a.green - b.green), std::fabs(a.blue - b.blue)));
+}
+
+static float referenceLimit(float x) {
+  if (std::isnan(x)) { return 0.0f; }
+  if (x < 0.0f) { return 0.0f; }
+  if (x > 1.0f) { return 1.0f; }
+  return x;
+}
+
+// The preset formulas as they were before presets.cpp, in float through the C library, so the tables are checked
+// against something that doesn't share their maths
+static Rgb referencePreset(uint8_t palette, float lerp) {
+  switch (palette) {
+    case 240: return Rgb(
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f)),
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f + 4.0f * M_PI / 3.0f)),
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f + 2.0f * M_PI / 3.0f)));
+    case 241: return Rgb(
+      std::pow(lerp, 0.2f)*std::pow(1.07f-lerp, 0.01f),
+      std::pow(lerp, 0.8f)*std::pow(1.05f-lerp, 0.01f),
+      std::pow(lerp, 2.0f));
+    case 242: lerp = 1.0f - lerp; return Rgb(
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 17.0f)),
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 15.5)),
+      std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 14.0f)));
+    case 243: return Rgb(
+      std::pow(lerp, 0.3f)*referenceLimit(0.4f - 0.6f * std::cos(lerp * 0.75f * M_PI + 0.2f*M_PI)),
+      std::pow(lerp, 0.15f)*referenceLimit(0.4f + 0.6f * std::cos(lerp * 0.75f * M_PI + 0.1f*M_PI)),
+      std::pow(lerp, 0.1f)*referenceLimit(1.0f + 0.0f * std::cos(lerp * 1.9f * M_PI + 0.1f*M_PI)));
+    case 244: return Rgb(
+      std::pow(lerp, 0.2f),
+      std::pow(lerp, 0.8f)*0.9f,
+      std::pow(lerp, 2.0f)*0.3f);
+    case 245: return Rgb(
+      std::pow(lerp, 0.5f),
+      std::pow(lerp, 1.5f)*0.8f,
+      std::pow(lerp, 0.07f)/(1.0f+lerp));
+  }
+  return Rgb();
+}
+
+// The tables are sampled at the lut's own lerps, so that's where they must match the formulas to within float
+// rounding. In between, both the tables and the lut interpolate linearly, so that error is reported but not bounded
+static const float presetTableTolerance = 1e-5f;
+
+static bool benchPreset(uint8_t palette, int frames) {
+  PaletteEntry entries[paletteLutSize+1];
+  PaletteLut lut;
+  lut.entries = entries;
+  Rgb off(0.0f, 0.0f, 0.0f);
+  double rebuildUs[2];
+  for (int tables=0; tables<2; tables++) {
+    setPresetTables(tables == 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int f=0; f<frames; f++) {
+      lut.valid = false; // Presets ignore their colours, so force the rebuild
+      updatePaletteLut(lut, palette, off, off);
+    }
+    rebuildUs[tables] = elapsedNs(start) / 1000.0 / frames;
+    sink = entries[paletteLutSize/2].red;
+  }
+  setPresetTables(true);
+  float sampleError = 0.0f;
+  float exactError = 0.0f;
+  for (uint16_t i=0; i<=presetTableSize; i++) {
+    float lerp = (float)i / presetTableSize;
+    Rgb reference = referencePreset(palette, lerp);
+    sampleError = std::max(sampleError, maxChannelDiff(presetTableColour(palette, lerp), reference));
+    exactError = std::max(exactError, maxChannelDiff(presetExactColour(palette, lerp), reference));
+  }
+  float betweenError = 0.0f;
+  for (uint32_t i=0; i<=presetTableSize*16u; i++) {
+    float lerp = (float)i / (presetTableSize*16u);
+    betweenError = std::max(betweenError, maxChannelDiff(presetTableColour(palette, lerp), referencePreset(palette, lerp)));
+  }
+  bool ok = sampleError <= presetTableTolerance && exactError <= presetTableTolerance;
+  printf("%d,%.2f,%.2f,%g,%g,%g,%s\n", palette, rebuildUs[0], rebuildUs[1], sampleError, exactError, betweenError, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool benchPresets(int frames) {
+  printf("palette,formula_rebuild_us,table_rebuild_us,table_error,formula_error,between_error,within_tolerance\n");
+  bool ok = true;
+  for (uint8_t palette : presetPalettes) { ok = benchPreset(palette, frames) && ok; }
+  return ok;
+}
+
+static Rgb chainRgb(const Stop& left, const Stop& right, float lerp) {
+  return Rgb(left.rgb.red + (right.rgb.red - left.rgb.red) * lerp, left.rgb.green + (right.rgb.green - left.rgb.green) * lerp,
+    left.rgb.blue + (right.rgb.blue - left.rgb.blue) * lerp);
+}
+
+static Rgb chainHsv(const Stop& left, const Stop& right, float lerp) {
+  return blendHsv(left.hsv, right.hsv, lerp);
+}
+
+// How the palettes chained stops before blendStops: blend3 to blend7 each peeling off one segment, and passing the
+// blend on as a function pointer
+static Rgb pointerChain(const Stop* stops, uint8_t count, float lerp, BlendFunc blend) {
+  if (count == 2) { return blend(stops[0], stops[1], lerp); }
+  float segments = (float)(count - 1);
+  if (lerp < 1.0f/segments) { return blend(stops[0], stops[1], lerp*segments); }
+  return pointerChain(stops + 1, count - 1, (lerp - 1.0f/segments)*segments/(segments - 1.0f), blend);
+}
+
+static void pointerFill(Rgb* out, const Stop* stops, uint8_t count, BlendFunc blend) {
+  for (uint16_t i=0; i<=paletteLutSize; i++) { out[i] = pointerChain(stops, count, (float)i / paletteLutSize, blend); }
+}
+
+// The stop count is picked once per fill, as updatePaletteLut() picks the layout once per rebuild
+template <BlendFunc Blend, typename... Stops>
+static void templateFillStops(Rgb* out, const Stops&... stops) {
+  for (uint16_t i=0; i<=paletteLutSize; i++) { out[i] = blendStops<Blend>((float)i / paletteLutSize, stops...); }
+}
+
+template <BlendFunc Blend>
+static void templateFill(Rgb* out, const Stop* s, uint8_t count, BlendFunc) {
+  switch (count) {
+    case 2: templateFillStops<Blend>(out, s[0], s[1]); break;
+    case 3: templateFillStops<Blend>(out, s[0], s[1], s[2]); break;
+    case 4: templateFillStops<Blend>(out, s[0], s[1], s[2], s[3]); break;
+    case 5: templateFillStops<Blend>(out, s[0], s[1], s[2], s[3], s[4]); break;
+    case 6: templateFillStops<Blend>(out, s[0], s[1], s[2], s[3], s[4], s[5]); break;
+    default: templateFillStops<Blend>(out, s[0], s[1], s[2], s[3], s[4], s[5], s[6]); break;
+  }
+}
+
+typedef void (*ChainFill)(Rgb* out, const Stop* stops, uint8_t count, BlendFunc blend);
+
+// Called through a volatile pointer, so neither fill is inlined into the timing loop and folded against its constants
+static double timeChainFill(ChainFill fill, Rgb* out, const Stop* stops, uint8_t count, BlendFunc blend, int frames) {
+  ChainFill volatile call = fill;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int frame=0; frame<frames; frame++) { call(out, stops, count, blend); }
+  sink = out[paletteLutSize/2].green;
+  return elapsedNs(start) / ((double)frames * (paletteLutSize + 1));
+}
+
+// A lut filled per frame both ways, the best of several interleaved passes, and checked to give the same colours
+template <BlendFunc Blend>
+static void benchChain(const char* name, uint8_t count, int frames) {
+  Rgb back(0.1f, 0.2f, 0.6f), fore(0.9f, 0.5f, 0.1f);
+  Stop stops[7] = { Stop(Rgb()), Stop(back), Stop(fore), Stop(back), Stop(fore), Stop(back), Stop(fore) };
+  Rgb pointerLut[paletteLutSize + 1], templateLut[paletteLutSize + 1];
+  double pointerNs = 1.0e9, templateNs = 1.0e9;
+  for (int pass=0; pass<5; pass++) {
+    pointerNs = std::min(pointerNs, timeChainFill(pointerFill, pointerLut, stops, count, Blend, frames / 5 + 1));
+    templateNs = std::min(templateNs, timeChainFill(templateFill<Blend>, templateLut, stops, count, Blend, frames / 5 + 1));
+  }
+  float maxDiff = 0.0f;
+  for (uint16_t i=0; i<=paletteLutSize; i++) { maxDiff = std::max(maxDiff, maxChannelDiff(pointerLut[i], templateLut[i])); }
+  printf("%s,%d,%.2f,%.2f,%g\n", name, count, pointerNs, templateNs, maxDiff);
+}
+
+static void benchChains(int frames) {
+  printf("blend,stops,pointer_ns,template_ns,max_diff\n");
+  for (uint8_t count=2; count<=7; count++) { benchChain<chainRgb>("rgb", count, frames); }
+  for (uint8_t count=2; count<=7; count++) { benchChain<chainHsv>("hsv", count, frames); }
+}
+
+// The same dimmer and gamma maths setOutputLevels() builds its table from, per channel
+static float referenceLevel(float v, float dmxDimmer, float dmxGamma) {
+  float dimmer = dmxDimmer == 0.0f ? 1.0f : dmxDimmer;
+  float gamma = dmxGamma == 0.0f ? 1.25f : 0.25f+dmxGamma*3.75f;
+  return powf(v, gamma) * dimmer * 255.0f;
+}
+
+static bool benchGammaLevels(float dmxDimmer, float dmxGamma, int frames) {
+  setOutputLevels(dmxDimmer, dmxGamma);
+  float maxError = 0.0f;
+  for (uint16_t i=0; i<outputLutSize; i++) {
+    float v = (float)i / (float)(outputLutSize-1);
+    maxError = std::max(maxError, std::fabs((float)outputChannel(v) - referenceLevel(v, dmxDimmer, dmxGamma)));
+  }
+  uint32_t samples = (uint32_t)frames * outputLutSize;
+  uint32_t total = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t i=0; i<samples; i++) { total += outputChannel((float)(i % outputLutSize) / (float)(outputLutSize-1)); }
+  double tableNs = elapsedNs(start) / samples;
+  float totalPow = 0.0f;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i=0; i<samples; i++) { totalPow += referenceLevel((float)(i % outputLutSize) / (float)(outputLutSize-1), dmxDimmer, dmxGamma); }
+  double powNs = elapsedNs(start) / samples;
+  sink = (float)total + totalPow;
+  bool ok = maxError <= 1.0f;
+  printf("%.2f,%.2f,%.2f,%.2f,%g,%s\n", dmxDimmer, dmxGamma, tableNs, powNs, maxError, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool benchGamma(int frames) {
+  const float dimmers[] = { 0.0f, 1.0f, 0.5f, 0.1f };
+  const float gammas[] = { 0.0f, 0.2f, 0.5f, 1.0f };
+  printf("dmx_dimmer,dmx_gamma,table_ns,powf_ns,max_error,within_one_count\n");
+  bool ok = true;
+  for (float dimmer : dimmers) {
+    for (float gamma : gammas) { ok = benchGammaLevels(dimmer, gamma, frames) && ok; }
+  }
+  setOutputLevels(0.0f, 0.0f);
+  return ok;
+}
+
+// Every pixel value once, at the lut's sample points, between them, and out of range, then a smooth sweep
+static void fillOutputTest(PixelStrip& strip) {
+  const float edges[] = { 0.0f, 1.0f, -0.25f, 1.5f, NAN, 0.5f / paletteLutSize, 1.0f - 0.5f / paletteLutSize };
+  uint8_t edgeCount = sizeof(edges) / sizeof(edges[0]);
+  for (uint16_t i=0; i<strip.length; i++) {
+    if (i < edgeCount) { strip.pixels[i] = edges[i]; }
+    else if (i < edgeCount + paletteLutSize*4) { strip.pixels[i] = (float)(i - edgeCount) / (paletteLutSize*4); }
+    else { strip.pixels[i] = 0.5f + 0.5f * sinf((float)i * 0.01f); }
+  }
+}
+
+static bool benchFusedOutput(PixelLayout layout, const char* layoutName, uint8_t palette, uint16_t length, int frames) {
+  PixelStrip strip(length, layout);
+  uint32_t bytes = length * (layout == LayoutGrb ? 3 : 4);
+  uint8_t* staged = new uint8_t[bytes];
+  uint8_t* fused = new uint8_t[bytes];
+  fillOutputTest(strip);
+  updatePaletteLut(strip.paletteLut, palette, Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f));
+  strip.output = staged;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) { outputStripStaged(strip, strip.pixels, 0, length); }
+  double stagedNs = elapsedNs(start) / frames / length;
+  strip.output = fused;
+  start = std::chrono::steady_clock::now();
+  for (int f=0; f<frames; f++) { outputStrip(strip, strip.pixels, 0, length); }
+  double fusedNs = elapsedNs(start) / frames / length;
+  uint32_t mismatches = 0;
+  for (uint32_t i=0; i<bytes; i++) { if (staged[i] != fused[i]) { mismatches++; } }
+  printf("%s,%d,%d,%.2f,%.2f,%u\n", layoutName, palette, length, stagedNs, fusedNs, mismatches);
+  delete[] staged;
+  delete[] fused;
+  return mismatches == 0;
+}
+
+static bool benchFused(int frames) {
+  setOutputLevels(0.0f, 0.0f);
+  setGradient(0, "0:000000 64:ff0000:h 128:ffff00:o 192:00ffff:s 224:0000ff 255:ffffff");
+  const PixelLayout layouts[] = { LayoutGrb, LayoutGrbw, LayoutApa102 };
+  const char* layoutNames[] = { "grb", "grbw", "apa102" };
+  const uint8_t palettes[] = { 0, 18, 50, 70, 100, 240, gradientFirst }; // Interpolated and nearest entry luts
+  printf("layout,palette,length,staged_ns_per_pixel,fused_ns_per_pixel,mismatched_bytes\n");
+  bool ok = true;
+  for (uint8_t l=0; l<3; l++) {
+    for (uint8_t palette : palettes) {
+      for (uint16_t length : lengths) { ok = benchFusedOutput(layouts[l], layoutNames[l], palette, length, frames) && ok; }
+    }
+  }
+  return ok;
+}
+
+// The last frame of every mode against every palette, one after another in a fixed order so builds can be compared
+static const uint16_t equivalenceLength = 60;
+
+static std::vector<uint8_t> renderEquivalence(int frames) {
+  setOutputLevels(0.0f, 0.0f);
+  std::vector<uint8_t> renders;
+  PixelStrip strip(equivalenceLength, LayoutGrbw);
+  std::vector<uint8_t> output(equivalenceLength * 4);
+  strip.output = output.data();
+  for (uint8_t m=0; m<modeCount; m++) {
+    for (uint8_t family : paletteFamilies) {
+      for (uint8_t variant=0; variant<=8; variant++) {
+        Controls controls(Rgb(0.1f, 0.2f, 0.6f), Rgb(0.9f, 0.5f, 0.1f));
+        controls.mode = modeTable[m].id;
+        controls.palette = family + variant;
+        strip.random.seed(1);
+        uint64_t timeUs = 0;
+        for (int f=0; f<frames; f++) {
+          animateControls(controls, f);
+          timeUs += frameTimeUs;
+          updateStrip(controls, strip, timeUs);
+        }
+        renders.insert(renders.end(), output.begin(), output.end());
+      }
+    }
+  }
+  return renders;
+}
+
+#ifndef PIXEL_FIXED_POINT // Only the float build compares
+// Q0.16 pixels round differently to float, so the output can be a few counts out. Step and dither palettes don't
+// blend, so a pixel sitting right on one of their transitions can land on the other side of it instead. The blur
+// modes round every frame, and dither palettes have dozens of transitions, so allow a tenth of the strip to flip
+static const uint8_t fixedByteTolerance = 4;
+static const uint8_t fixedFlippedPixels = equivalenceLength / 10;
+
+static bool paletteInterpolates(uint8_t palette) {
+  PaletteEntry entries[paletteLutSize+1];
+  PaletteLut lut;
+  lut.entries = entries;
+  updatePaletteLut(lut, palette, Rgb(), Rgb());
+  return lut.interpolate;
+}
+#endif
+
+static bool benchFixed(int frames, const char* path) {
+  std::vector<uint8_t> renders = renderEquivalence(frames);
+#ifdef PIXEL_FIXED_POINT
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr || fwrite(renders.data(), 1, renders.size(), file) != renders.size()) {
+    fprintf(stderr, "Couldn't write %s\n", path);
+    if (file != nullptr) { fclose(file); }
+    return false;
+  }
+  fclose(file);
+  return true;
+#else
+  std::vector<uint8_t> fixed(renders.size());
+  FILE* file = fopen(path, "rb");
+  bool loaded = file != nullptr && fread(fixed.data(), 1, fixed.size(), file) == fixed.size() && fgetc(file) == EOF;
+  if (file != nullptr) { fclose(file); }
+  if (!loaded) {
+    fprintf(stderr, "Couldn't read a fixed point render of the same modes and frames from %s\n", path);
+    return false;
+  }
+  printf("mode,palette,max_diff,mean_diff,pixels_over,within_tolerance\n");
+  bool ok = true;
+  const uint8_t* floatPixel = renders.data();
+  const uint8_t* fixedPixel = fixed.data();
+  for (uint8_t m=0; m<modeCount; m++) {
+    for (uint8_t family : paletteFamilies) {
+      for (uint8_t variant=0; variant<=8; variant++) {
+        uint8_t palette = family + variant;
+        uint8_t maxDiff = 0;
+        uint32_t totalDiff = 0;
+        uint16_t pixelsOver = 0;
+        for (uint16_t i=0; i<equivalenceLength; i++) {
+          uint8_t pixelDiff = 0;
+          for (uint8_t c=0; c<4; c++) { pixelDiff = std::max(pixelDiff, (uint8_t)std::abs((int)floatPixel[c] - (int)fixedPixel[c])); totalDiff += (uint32_t)std::abs((int)floatPixel[c] - (int)fixedPixel[c]); }
+          maxDiff = std::max(maxDiff, pixelDiff);
+          if (pixelDiff > fixedByteTolerance) { pixelsOver++; }
+          floatPixel += 4;
+          fixedPixel += 4;
+        }
+        bool within = pixelsOver == 0 || (!paletteInterpolates(palette) && pixelsOver <= fixedFlippedPixels);
+        ok = ok && within;
+        printf("%d,%d,%d,%.3f,%d,%s\n", modeTable[m].id, palette, maxDiff, (float)totalDiff / (equivalenceLength*4u), pixelsOver, within ? "ok" : "FAIL");
+      }
+    }
+  }
+  return ok;
+#endif
+}
+
+static void listModes() {
+  printf("mode,name,reads_previous,uses_velocity,stateless,time_dependent,sparse\n");
+  for (uint8_t m=0; m<modeCount; m++) {
+    const ModeInfo& info = modeTable[m];
+    printf("%d,%s,%d,%d,%d,%d,%d\n", info.id, info.name, (info.flags & ModeReadsPrevious) != 0, (info.flags & ModeUsesVelocity) != 0,
+      (info.flags & ModeStateless) != 0, (info.flags & ModeTimeDependent) != 0, (info.flags & ModeSparse) != 0);
+  }
+}
+
+int main (int argc, char** argv) {
+  const char* suite = (argc > 1) ? argv[1] : "modes";
+  int frames = (argc > 2) ? atoi(argv[2]) : 20;
+  if (strcmp(suite, "modes") == 0) {
+    benchModes(frames);
+  } else if (strcmp(suite, "stages") == 0) {
+    benchStages(frames);
+  } else if (strcmp(suite, "pipeline") == 0) {
+    benchPipeline(frames);
+  } else if (strcmp(suite, "workers") == 0) {
+    benchWorkers(frames);
+  } else if (strcmp(suite, "noise") == 0) {
+    printf("kernel,length,per_pixel_ns,batched_ns\n");
+    for (uint16_t length : lengths) { benchNoise(length, frames*10); }
+  } else if (strcmp(suite, "palettes") == 0) {
+    benchPalettes(frames);
+  } else if (strcmp(suite, "presets") == 0) {
+    if (!benchPresets(frames)) { return 1; }
+  } else if (strcmp(suite, "chains") == 0) {
+    benchChains(frames * 50);
+  } else if (strcmp(suite, "gamma") == 0) {
+    if (!benchGamma(frames)) { return 1; }
+  } else if (strcmp(suite, "fused") == 0) {
+    if (!benchFused(frames * 10)) { return 1; }
+  } else if (strcmp(suite, "fixed") == 0) {
+    if (!benchFixed(frames, (argc > 3) ? argv[3] : "fixed-render.bin")) { return 1; }
+  } else if (strcmp(suite, "list") == 0) {
+    listModes();
+  } else {
+    fprintf(stderr, "Unknown suite %s, use modes, stages, pipeline, workers, noise, palettes, presets, chains, gamma, fused, fixed or list\n", suite);
+    return 1;
+  }
+  return 0;
+}
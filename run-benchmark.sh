@@ -0,0 +1,14 @@
+#!/bin/bash
+# Build and run the headless benchmarks as a local optimised executable. OPT=-Os matches the ESP32 build's optimisation
+#  ./run-benchmark.sh [modes|stages|pipeline|workers|noise|palettes|presets|chains|gamma|fused|fixed|list] [frames] > results.csv
+
+OPT="${OPT:--O2}"
+SOURCES="benchmark.cpp sketch/modes.cpp sketch/palettes.cpp sketch/presets.cpp sketch/gradients.cpp sketch/perlin.cpp sketch/colour.cpp sketch/output.cpp sketch/timing.cpp sketch/scheduler.cpp sketch/pipeline.cpp sketch/workers.cpp sketch/engine.cpp"
+g++ -std=c++11 $OPT $SOURCES -lm -pthread -o benchmark.exe || exit 1
+if [ "$1" = "fixed" ]; then # Render with Q0.16 pixels first, for the float build to compare against
+  g++ -std=c++11 $OPT -DPIXEL_FIXED_POINT $SOURCES -lm -pthread -o benchmark-fixed.exe || exit 1
+  ./benchmark-fixed.exe fixed "${2:-20}" fixed-render.bin || exit 1
+  ./benchmark.exe fixed "${2:-20}" fixed-render.bin
+  exit $?
+fi
+./benchmark.exe "$@"
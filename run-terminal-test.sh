@@ -1,5 +1,6 @@
 #!/bin/bash
 # Build as a local executable to allow testing the effects
+#  ./run-terminal-test.sh [gradient files...]
 
-g++ -std=c++11 terminal-test.cpp sketch/modes.cpp sketch/palettes.cpp sketch/perlin.cpp sketch/hsv.cpp -lm -o terminal-test.exe
-./terminal-test.exe
+g++ -std=c++11 terminal-test.cpp sketch/modes.cpp sketch/palettes.cpp sketch/presets.cpp sketch/gradients.cpp sketch/perlin.cpp sketch/colour.cpp sketch/output.cpp sketch/timing.cpp sketch/scheduler.cpp sketch/pipeline.cpp sketch/workers.cpp sketch/engine.cpp -lm -pthread -o terminal-test.exe
+./terminal-test.exe "$@"
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+
+const uint32_t arenaAlign = 16; // Enough for any scalar type, and for vector loads over the pixel buffers
+
+// Bump allocator handing out aligned buffers from one block. Everything is released together, either by
+// reset() so the block can be reused for a new strip layout, or when the arena goes away
+struct Arena {
+  uint8_t* memory;
+  uint32_t capacity;
+  uint32_t used;
+  bool owned;
+  Arena (uint32_t _capacity) {
+    memory = new (std::nothrow) uint8_t[_capacity + arenaAlign];
+    capacity = (memory == nullptr) ? 0 : _capacity + arenaAlign; // Out of memory leaves an empty arena, so every alloc fails
+    owned = true;
+    reset();
+  }
+  Arena (uint8_t* _memory, uint32_t _capacity) {
+    memory = _memory;
+    capacity = _capacity;
+    owned = false;
+    reset();
+  }
+  ~Arena () { if (owned) { delete[] memory; } }
+  Arena (const Arena&) = delete;
+  Arena& operator= (const Arena&) = delete;
+  void reset () {
+    used = 0;
+    skipToAlignment();
+  }
+  static uint32_t alignUp (uint32_t bytes) { return (bytes + arenaAlign - 1) & ~(arenaAlign - 1); }
+  // Space an allocation takes up, for sizing an arena up front
+  template <typename T> static uint32_t bytesFor (uint32_t count) { return alignUp(count * sizeof(T)); }
+  // Value initialised, so buffers start zeroed. Returns nullptr when the arena is full
+  template <typename T> T* alloc (uint32_t count) {
+    uint32_t bytes = bytesFor<T>(count);
+    if (used + bytes > capacity) { return nullptr; }
+    T* buffer = (T*)(memory + used);
+    for (uint32_t i=0; i<count; i++) { new (&buffer[i]) T(); }
+    used += bytes;
+    return buffer;
+  }
+  uint32_t remaining () const { return capacity - used; }
+private:
+  void skipToAlignment () {
+    uintptr_t address = (uintptr_t)memory;
+    used = (uint32_t)(((address + arenaAlign - 1) & ~(uintptr_t)(arenaAlign - 1)) - address);
+  }
+};
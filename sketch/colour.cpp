@@ -0,0 +1,223 @@
+#include <algorithm> // For std::max/min
+#include <cmath>     // For frexp/ldexp and building the cbrt table
+#include "colour.h"
+
+// --- Conversion Functions ---
+
+/**
+ * @brief Converts an Rgb color to Hsv color space.
+ */
+Hsv rgbToHsv(const Rgb& color) {
+    float r = color.red;
+    float g = color.green;
+    float b = color.blue;
+
+    float M = std::max({r, g, b}); // Max component (Value)
+    float m = std::min({r, g, b}); // Min component
+    float C = M - m;               // Chroma
+
+    Hsv hsv;
+    hsv.v = M; // Value is the maximum component
+
+    // Saturation calculation
+    if (M == 0.0f) {
+        hsv.s = 0.0f; // Black, gray, or white
+    } else {
+        hsv.s = C / M;
+    }
+
+    // Hue calculation, in sextants
+    if (C == 0.0f) {
+        hsv.h = 0.0f; // Hue is undefined for achromatic colors, use 0
+    } else {
+        if (M == r) {
+            hsv.h = (g - b) / C;
+        } else if (M == g) {
+            hsv.h = (b - r) / C + 2.0f;
+        } else { // M == b
+            hsv.h = (r - g) / C + 4.0f;
+        }
+
+        if (hsv.h < 0.0f) {
+            hsv.h += 6.0f;
+        }
+    }
+
+    return hsv;
+}
+
+/**
+ * @brief How far one channel sits below the value, for hsvToRgb().
+ *        k is the hue offset by the channel's phase, in [0, 12).
+ */
+static float hsvChannel(float k, float v, float C) {
+    k = (k >= 6.0f) ? k - 6.0f : k; // Compiles to a select rather than a branch
+    float ramp = std::min(std::min(k, 4.0f - k), 1.0f);
+    return v - C * std::max(ramp, 0.0f);
+}
+
+/**
+ * @brief Converts an Hsv color to Rgb color space.
+ * Each channel is a clamped triangle wave of the hue, so there is no
+ * fmod or six way branch on the sextant.
+ */
+Rgb hsvToRgb(const Hsv& hsv) {
+    float C = hsv.v * hsv.s; // Chroma
+    return Rgb(
+        hsvChannel(hsv.h + 5.0f, hsv.v, C),
+        hsvChannel(hsv.h + 3.0f, hsv.v, C),
+        hsvChannel(hsv.h + 1.0f, hsv.v, C)
+    );
+}
+
+// --- Table Driven Cube Root ---
+
+// cbrt of the mantissa range [0.5, 1], and of the three possible exponent remainders
+static const uint8_t cbrtTableSize = 32;
+static float cbrtTable[cbrtTableSize + 1];
+static float cbrtExponent[3];
+
+/**
+ * @brief Fills the cbrt tables. Like the Perlin table this runs during static
+ *        initialisation, so the tables are read only from then on.
+ */
+static void cbrt_init() {
+    for (uint8_t i = 0; i <= cbrtTableSize; i++) {
+        cbrtTable[i] = std::cbrt(0.5f + 0.5f * (float)i / (float)cbrtTableSize);
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        cbrtExponent[i] = std::cbrt((float)(1 << i));
+    }
+}
+
+struct CbrtInit {
+    CbrtInit() { cbrt_init(); }
+};
+static CbrtInit cbrt_inited;
+
+/**
+ * @brief Cube root from a table lookup on the mantissa and one Newton step,
+ *        which is accurate to within a couple of float ulps.
+ */
+float tableCbrt(float x) {
+    if (x < 0.0f) { return -tableCbrt(-x); }
+    if (!(x > 0.0f)) { return 0.0f; } // Also catches NaN
+
+    int e;
+    float m = std::frexp(x, &e); // x = m * 2^e, m in [0.5, 1)
+    float pos = (m - 0.5f) * 2.0f * (float)cbrtTableSize;
+    uint8_t idx = (uint8_t)pos;
+    float frac = pos - (float)idx;
+    float y = cbrtTable[idx] + (cbrtTable[idx + 1] - cbrtTable[idx]) * frac;
+
+    // e = 3q + r with r in [0, 3), rounding q down for negative exponents too
+    int q = (e >= 0) ? e / 3 : -((2 - e) / 3);
+    y = std::ldexp(y * cbrtExponent[e - 3 * q], q);
+
+    return y - (y * y * y - x) / (3.0f * y * y);
+}
+
+/**
+ * @brief Converts a linear Rgb color to OKLab, as published by Björn Ottosson.
+ */
+Oklab rgbToOklab(const Rgb& color) {
+    float l = 0.4122214708f * color.red + 0.5363325363f * color.green + 0.0514459929f * color.blue;
+    float m = 0.2119034982f * color.red + 0.6806995451f * color.green + 0.1073969566f * color.blue;
+    float s = 0.0883024619f * color.red + 0.2817188376f * color.green + 0.6299787005f * color.blue;
+
+    l = tableCbrt(l);
+    m = tableCbrt(m);
+    s = tableCbrt(s);
+
+    Oklab lab;
+    lab.l = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+    lab.a = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+    lab.b = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+    return lab;
+}
+
+/**
+ * @brief Converts an OKLab color back to linear Rgb. Blends between in gamut
+ *        colors can land slightly outside it, so the result is clamped.
+ */
+Rgb oklabToRgb(const Oklab& lab) {
+    float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+    float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+    float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+
+    return Rgb(
+        std::min(std::max(4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s, 0.0f), 1.0f),
+        std::min(std::max(-1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s, 0.0f), 1.0f),
+        std::min(std::max(-0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s, 0.0f), 1.0f)
+    );
+}
+
+// --- HSV LERP with Shortest Hue Path ---
+
+/**
+ * @brief Performs linear interpolation (LERP) between two Hsv colors and
+ * converts the result to Rgb.
+ * * The Hue blending uses the shortest path around the color wheel.
+ * @param left The starting color (lerp=0.0f).
+ * @param right The ending color (lerp=1.0f).
+ * @param lerp The interpolation factor, clamped to the range [0.0f, 1.0f].
+ * @return The blended Rgb color.
+ */
+Rgb blendHsv(const Hsv& left, const Hsv& right, float lerp) {
+  // Clamp 't' to the range [0.0f, 1.0f]
+  float t = std::max(std::min(lerp, 1.0f), 0.0f);
+
+  // 1. Perform LERP on S and V components (simple linear interpolation)
+  Hsv hsv_result;
+  hsv_result.s = left.s + t * (right.s - left.s);
+  hsv_result.v = left.v + t * (right.v - left.v);
+
+  // 2. Perform LERP on Hue (H) component (circular shortest path with achromatic fix)
+
+  // Use a small epsilon for floating-point comparison with zero saturation.
+  const float S_EPSILON = 1e-6f;
+
+  // An achromatic end takes the other end's hue, to maintain hue constancy as saturation changes.
+  // If both are achromatic the hue doesn't matter.
+  float hue_start = (left.s < S_EPSILON && right.s > S_EPSILON) ? right.h : left.h;
+  float hue_end = (right.s < S_EPSILON && left.s > S_EPSILON) ? left.h : right.h;
+
+  // Adjust difference to take the shortest path around the 6 sextant circle
+  float hue_diff = hue_end - hue_start;
+  hue_diff += (hue_diff < -3.0f) ? 6.0f : 0.0f;
+  hue_diff -= (hue_diff > 3.0f) ? 6.0f : 0.0f;
+
+  // LERP the hue, and wrap the result back into [0, 6). Both ends are in [0, 6) and the
+  // step is at most half a turn, so a single fixed step either way is all it needs
+  float h = hue_start + t * hue_diff;
+  h += (h < 0.0f) ? 6.0f : 0.0f;
+  h -= (h >= 6.0f) ? 6.0f : 0.0f;
+  hsv_result.h = h;
+
+  // 3. Convert Hsv result back to Rgb
+  return hsvToRgb(hsv_result);
+}
+
+/**
+ * @brief Straight LERP through OKLab, so lightness changes evenly to the eye.
+ */
+Rgb blendOklab(const Oklab& left, const Oklab& right, float lerp) {
+  float t = std::max(std::min(lerp, 1.0f), 0.0f);
+  Oklab lab;
+  lab.l = left.l + t * (right.l - left.l);
+  lab.a = left.a + t * (right.a - left.a);
+  lab.b = left.b + t * (right.b - left.b);
+  return oklabToRgb(lab);
+}
+
+Rgb blendHsv(const Rgb& left, const Rgb& right, float lerp) {
+  return blendHsv(rgbToHsv(left), rgbToHsv(right), lerp);
+}
+
+Rgb blendOklab(const Rgb& left, const Rgb& right, float lerp) {
+  return blendOklab(rgbToOklab(left), rgbToOklab(right), lerp);
+}
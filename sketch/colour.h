@@ -0,0 +1,29 @@
+#pragma once
+#include "modes.h"
+
+// Hue in sextants [0, 6), saturation and value [0, 1]
+struct Hsv {
+  float h;
+  float s;
+  float v;
+};
+
+// Perceptual lightness and the two opponent colour axes
+struct Oklab {
+  float l;
+  float a;
+  float b;
+};
+
+Hsv rgbToHsv(const Rgb& colour);
+Rgb hsvToRgb(const Hsv& hsv);
+Oklab rgbToOklab(const Rgb& colour);
+Rgb oklabToRgb(const Oklab& lab);
+float tableCbrt(float x);
+
+// Blends between endpoints already converted into the blend's colour space, so palettes
+// can convert their colours once rather than for every sample
+Rgb blendHsv(const Hsv& left, const Hsv& right, float lerp);
+Rgb blendOklab(const Oklab& left, const Oklab& right, float lerp);
+Rgb blendHsv(const Rgb& left, const Rgb& right, float lerp);
+Rgb blendOklab(const Rgb& left, const Rgb& right, float lerp);
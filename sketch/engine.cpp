@@ -0,0 +1,87 @@
+#include <new>
+#include "engine.h"
+#include "workers.h"
+
+StripEngine::StripEngine(const StripConfig* configs, uint8_t _count, PixelLayout layout) {
+  count = 0;
+  arena = nullptr;
+  keepAliveFrames = 0;
+  configure(configs, _count, layout);
+}
+
+StripEngine::~StripEngine() {
+  releaseStrips();
+  delete arena;
+}
+
+uint32_t StripEngine::arenaBytes(const StripConfig* configs, uint8_t _count) {
+  uint32_t bytes = 0;
+  for (uint8_t i=0; i<_count && i<maxStrips; i++) {
+    bytes += Arena::bytesFor<PixelStrip>(1) + PixelStrip::bufferBytes(configs[i].length, !configs[i].stateless);
+  }
+  return bytes;
+}
+
+void StripEngine::releaseStrips() {
+  for (uint8_t i=0; i<count; i++) { strips[i]->~PixelStrip(); }
+  count = 0;
+}
+
+// Reuses the arena when the new layout fits, so changing layout at runtime doesn't fragment the heap
+bool StripEngine::configure(const StripConfig* configs, uint8_t _count, PixelLayout layout) {
+  releaseStrips();
+  uint32_t bytes = arenaBytes(configs, _count);
+  if (arena != nullptr && bytes > arena->capacity - arenaAlign) {
+    delete arena;
+    arena = nullptr;
+  }
+  if (arena == nullptr) { arena = new Arena(bytes); }
+  arena->reset();
+  uint16_t dmxOffset = 0;
+  outputBytes = 0;
+  if (arena->remaining() < bytes) { // Every buffer below comes out of the arena, so checking the total up front covers them all
+    dmxGlobalOffset = 0;
+    return false;
+  }
+  count = _count > maxStrips ? maxStrips : _count;
+  for (uint8_t i=0; i<count; i++) {
+    void* stripMemory = arena->alloc<uint8_t>(Arena::bytesFor<PixelStrip>(1));
+    strips[i] = new (stripMemory) PixelStrip(configs[i].length, *arena, !configs[i].stateless);
+    strips[i]->setIndex(i);
+    strips[i]->outputLayout = layout;
+    controls[i] = Controls(configs[i].back, configs[i].fore);
+    dmxOffsets[i] = dmxOffset;
+    dmxOffset += configs[i].dmxFootprint < dmxStripChannels ? dmxStripChannels : configs[i].dmxFootprint;
+    outputOffsets[i] = outputBytes;
+    outputBytes += configs[i].length * bytesPerPixel(layout);
+    dirty[i] = true;
+    idleFrames[i] = 0;
+  }
+  dmxGlobalOffset = dmxOffset;
+  return true;
+}
+
+void StripEngine::setOutputFrame(uint8_t* frame) {
+  for (uint8_t i=0; i<count; i++) { strips[i]->output = frame + outputOffsets[i]; }
+}
+
+struct RenderJob {
+  StripEngine* engine;
+  uint64_t timeNow;
+};
+
+static void renderStrip (uint16_t index, void* context) {
+  RenderJob* job = (RenderJob*)context;
+  job->engine->dirty[index] = updateStrip(job->engine->controls[index], *job->engine->strips[index], job->timeNow);
+}
+
+void StripEngine::render(uint64_t timeNow) {
+  RenderJob job = { this, timeNow };
+  runParallel(renderStrip, &job, count);
+  for (uint8_t i=0; i<count; i++) {
+    if (dirty[i] || (keepAliveFrames != 0 && ++idleFrames[i] >= keepAliveFrames)) {
+      dirty[i] = true;
+      idleFrames[i] = 0;
+    }
+  }
+}
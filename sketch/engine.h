@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include "modes.h"
+
+const uint8_t maxStrips = 8; // Outputs on the NeoEsp32I2s1X8 methods
+const uint8_t dmxStripChannels = 10; // Mode, palette, control, smooth, back RGB, fore RGB
+
+// One output. A footprint bigger than dmxStripChannels leaves spare channels after the strip, to match a patch
+struct StripConfig {
+  uint8_t pin;
+  uint16_t length;
+  uint16_t dmxFootprint;
+  Rgb back; // Colours until DMX arrives
+  Rgb fore;
+  bool stateless; // No velocity buffer, to save memory on strips that won't run the wave modes (they blur instead)
+};
+
+// All the strips of a fixture, with every strip and its buffers in one arena
+struct StripEngine {
+  uint8_t count;
+  PixelStrip* strips[maxStrips];
+  Controls controls[maxStrips];
+  uint16_t dmxOffsets[maxStrips]; // From the start channel
+  uint16_t dmxGlobalOffset; // Dimmer and gamma follow the last strip
+  uint32_t outputOffsets[maxStrips]; // Where each strip goes in a packed frame of every strip in turn
+  uint32_t outputBytes;
+  bool dirty[maxStrips]; // Whether each strip needs sending after the last render()
+  uint16_t idleFrames[maxStrips];
+  uint16_t keepAliveFrames; // Resend a strip after this many frames unchanged, 0 for never
+  Arena* arena;
+  StripEngine (const StripConfig* configs, uint8_t _count, PixelLayout layout);
+  ~StripEngine ();
+  StripEngine (const StripEngine&) = delete;
+  StripEngine& operator= (const StripEngine&) = delete;
+  // Output buffers need setting again after this. False when the layout doesn't fit in memory, which leaves no strips
+  bool configure(const StripConfig* configs, uint8_t _count, PixelLayout layout);
+  static uint32_t arenaBytes(const StripConfig* configs, uint8_t _count);
+  void setOutputFrame(uint8_t* frame);
+  void render(uint64_t timeNow); // Spread across the worker pool, if one is running
+private:
+  void releaseStrips();
+};
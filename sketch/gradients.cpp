@@ -0,0 +1,178 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include "gradients.h"
+#include "colour.h"
+
+enum GradientBlend {
+  GradientRgb,
+  GradientHsv,
+  GradientOklab,
+  GradientStep
+};
+
+struct GradientStop {
+  uint8_t position;
+  uint8_t blend; // For the segment up to the next stop
+  Rgb colour;
+};
+
+// Sampled at the same lerps as the strips' palette luts, so rebuilding one from a gradient only copies entries.
+// Packed to 16 bits a channel, and only allocated for slots that have been uploaded
+static Rgb16* gradientLuts[gradientSlots];
+static bool hardEdges[gradientSlots];
+static uint32_t generation = 0;
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') { return c - '0'; }
+  if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+  if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+  return -1;
+}
+
+static bool isSeparator(char c) {
+  return c == '\0' || c == ',' || isspace((unsigned char)c);
+}
+
+static bool parseHexByte(const char* text, float& channel) {
+  int high = hexDigit(text[0]);
+  int low = (high < 0) ? -1 : hexDigit(text[1]);
+  if (low < 0) { return false; }
+  channel = (float)(high * 16 + low) / 255.0f;
+  return true;
+}
+
+// One pos:rrggbb[:blend] stop, leaving text just after it
+static bool parseStop(const char*& text, GradientStop& stop) {
+  char* end;
+  long position = strtol(text, &end, 10);
+  if (end == text || *end != ':' || position < 0 || position > 255) { return false; }
+  stop.position = (uint8_t)position;
+  const char* hex = end + 1;
+  if (!parseHexByte(hex, stop.colour.red) || !parseHexByte(hex + 2, stop.colour.green) || !parseHexByte(hex + 4, stop.colour.blue)) { return false; }
+  text = hex + 6;
+  stop.blend = GradientRgb;
+  if (*text == ':') {
+    switch (text[1]) {
+      case 'r': stop.blend = GradientRgb; break;
+      case 'h': stop.blend = GradientHsv; break;
+      case 'o': stop.blend = GradientOklab; break;
+      case 's': stop.blend = GradientStep; break;
+      default: return false;
+    }
+    text += 2;
+  }
+  return isSeparator(*text);
+}
+
+static uint8_t parseStops(const char* text, GradientStop* stops) {
+  uint8_t count = 0;
+  while (true) {
+    while (*text != '\0' && isSeparator(*text)) { text++; }
+    if (*text == '\0') { return count; }
+    if (count == gradientMaxStops) { return 0; }
+    if (!parseStop(text, stops[count])) { return 0; }
+    if (count > 0 && stops[count].position < stops[count-1].position) { return 0; }
+    count++;
+  }
+}
+
+static Rgb blendSegment(const GradientStop& left, const GradientStop& right, float lerp) {
+  switch (left.blend) {
+    case GradientHsv: return blendHsv(left.colour, right.colour, lerp);
+    case GradientOklab: return blendOklab(left.colour, right.colour, lerp);
+    case GradientStep: return (lerp < 0.5f) ? left.colour : right.colour;
+  }
+  return Rgb(
+    left.colour.red + (right.colour.red - left.colour.red) * lerp,
+    left.colour.green + (right.colour.green - left.colour.green) * lerp,
+    left.colour.blue + (right.colour.blue - left.colour.blue) * lerp
+  );
+}
+
+// Stops at the same position make a hard edge, since the segment between them is never sampled
+static Rgb sampleStops(const GradientStop* stops, uint8_t count, float position) {
+  if (position <= (float)stops[0].position) { return stops[0].colour; }
+  for (uint8_t i=1; i<count; i++) {
+    if (position < (float)stops[i].position) {
+      float lerp = (position - (float)stops[i-1].position) / (float)(stops[i].position - stops[i-1].position);
+      return blendSegment(stops[i-1], stops[i], lerp);
+    }
+  }
+  return stops[count-1].colour;
+}
+
+static uint16_t toQ16(float x) {
+  if (!(x > 0.0f)) { return 0; } // Also catches NaN
+  if (x >= 1.0f) { return 65535; }
+  return (uint16_t)(x*65535.0f + 0.5f);
+}
+
+bool isGradient(uint8_t type) {
+  return type >= gradientFirst && type < gradientFirst + gradientSlots;
+}
+
+// Uploads come in from the main loop between frames, so no strip is reading the lut while it is rewritten
+bool setGradient(uint8_t slot, const char* text) {
+  if (slot >= gradientSlots) { return false; }
+  GradientStop stops[gradientMaxStops];
+  uint8_t count = parseStops(text, stops);
+  if (count == 0) {
+    for (const char* c = text; *c != '\0'; c++) { if (!isSeparator(*c)) { return false; } } // Stops that didn't parse
+    delete[] gradientLuts[slot];
+    gradientLuts[slot] = nullptr;
+    generation++;
+    return true;
+  }
+  if (gradientLuts[slot] == nullptr) { gradientLuts[slot] = new Rgb16[paletteLutSize + 1]; }
+  Rgb16* lut = gradientLuts[slot];
+  hardEdges[slot] = false;
+  for (uint8_t i=0; i+1<count; i++) {
+    if (stops[i].blend == GradientStep || stops[i].position == stops[i+1].position) { hardEdges[slot] = true; }
+  }
+  for (uint16_t i=0; i<=paletteLutSize; i++) {
+    Rgb colour = sampleStops(stops, count, (float)i * 255.0f / (float)paletteLutSize);
+    lut[i] = Rgb16(toQ16(colour.red), toQ16(colour.green), toQ16(colour.blue));
+  }
+  generation++;
+  return true;
+}
+
+Rgb gradientColour(uint8_t type, float lerp) {
+  if (!isGradient(type) || gradientLuts[type - gradientFirst] == nullptr) { return Rgb(0, 0, 0); }
+  const Rgb16* lut = gradientLuts[type - gradientFirst];
+  float pos = lerp * (float)paletteLutSize;
+  if (!(pos > 0.0f)) { pos = 0.0f; } // Also catches NaN
+  if (hardEdges[type - gradientFirst]) { // Nearest entry, like a strip lut for this gradient
+    const Rgb16& nearest = lut[(pos >= (float)paletteLutSize) ? paletteLutSize : (uint16_t)(pos + 0.5f)];
+    return Rgb((float)nearest.red / 65535.0f, (float)nearest.green / 65535.0f, (float)nearest.blue / 65535.0f);
+  }
+  uint16_t idx = (pos >= (float)paletteLutSize) ? paletteLutSize - 1 : (uint16_t)pos;
+  float frac = pos - (float)idx;
+  const Rgb16& a = lut[idx];
+  const Rgb16& b = lut[idx + 1];
+  return Rgb(
+    ((float)a.red + ((float)b.red - (float)a.red) * frac) / 65535.0f,
+    ((float)a.green + ((float)b.green - (float)a.green) * frac) / 65535.0f,
+    ((float)a.blue + ((float)b.blue - (float)a.blue) * frac) / 65535.0f
+  );
+}
+
+bool gradientHasHardEdges(uint8_t type) {
+  return isGradient(type) && gradientLuts[type - gradientFirst] != nullptr && hardEdges[type - gradientFirst];
+}
+
+void copyGradientLut(uint8_t type, PaletteEntry* entries) {
+  const Rgb16* lut = isGradient(type) ? gradientLuts[type - gradientFirst] : nullptr;
+  for (uint16_t i=0; i<=paletteLutSize; i++) {
+    Rgb16 entry = (lut == nullptr) ? Rgb16() : lut[i];
+#ifdef PIXEL_FIXED_POINT
+    entries[i] = entry;
+#else
+    entries[i] = Rgb((float)entry.red / 65535.0f, (float)entry.green / 65535.0f, (float)entry.blue / 65535.0f);
+#endif
+  }
+}
+
+uint32_t gradientGeneration() {
+  return generation;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "modes.h"
+
+// Custom gradient palettes 200-207, uploaded as text and compiled into a lut
+//  u<slot> pos:rrggbb[:blend] ...
+// pos is 0-255 along the palette, rrggbb the hex colour, and blend how the segment from this stop to the next is
+// filled in: r RGB (default), h HSV, o OKLab or s step. Positions must not go backwards. No stops clears the slot
+const uint8_t gradientFirst = 200;
+const uint8_t gradientSlots = 8;
+const uint8_t gradientMaxStops = 16;
+
+bool isGradient(uint8_t type);
+bool setGradient(uint8_t slot, const char* stops); // False leaves the slot as it was
+Rgb gradientColour(uint8_t type, float lerp); // Black for an empty slot
+bool gradientHasHardEdges(uint8_t type); // Step segments or stops at the same position, which luts mustn't blend across
+void copyGradientLut(uint8_t type, PaletteEntry* entries); // paletteLutSize+1 entries, sampled at the same lerps
+uint32_t gradientGeneration(); // Changes whenever any gradient does, so luts built from them know to rebuild
@@ -1,4 +0,0 @@
-#pragma once
-#include "modes.h"
-
-Rgb blendHsv(const Rgb& left, const Rgb& right, float lerp);
@@ -1,7 +1,12 @@
 #include <cmath>
+#include <string.h>
 #include "modes.h"
 #include "palettes.h"
+#include "presets.h"
+#include "gradients.h"
 #include "perlin.h"
+#include "output.h"
+#include "timing.h"
 
 static float limit (float x) {
   if (std::isnan(x)) { return 0.0f; }
@@ -24,65 +29,115 @@ static float powerSmooth (float x, float p) {
   }
 }
 
+// Meter gradients apply the same power curve to every pixel, so sample it into a table only when smooth changes
+static void updateSmoothCurve (PixelStrip& strip, float smooth) {
+  if (smooth == strip.smoothCurveParam) { return; }
+  for (uint16_t i=0; i<=smoothCurveSize; i++) {
+    strip.smoothCurve[i] = powerSmooth((float)i / (float)smoothCurveSize, smooth);
+  }
+  strip.smoothCurveParam = smooth;
+}
+
+static float smoothCurve (const PixelStrip& strip, float x) {
+  float pos = limit(x) * (float)smoothCurveSize;
+  uint16_t idx = (uint16_t)pos;
+  if (idx >= smoothCurveSize) { idx = smoothCurveSize - 1; }
+  float frac = pos - (float)idx;
+  return strip.smoothCurve[idx] + (strip.smoothCurve[idx+1] - strip.smoothCurve[idx]) * frac;
+}
+
+// Pixels outside the active range are known to be 0, so fades, fizzles and blurs only need to visit the range.
+// Drawing widens it and decaying trims 0s off its ends, so a single plotted dot on a long strip is cheap.
+static void activate(PixelStrip& strip, uint16_t first, uint16_t last) {
+  if (strip.activeStart >= strip.activeEnd) {
+    strip.activeStart = first;
+    strip.activeEnd = last+1;
+    return;
+  }
+  if (first < strip.activeStart) { strip.activeStart = first; }
+  if (last+1 > strip.activeEnd) { strip.activeEnd = last+1; }
+}
+
+static void trimActive(PixelStrip& strip) {
+  while (strip.activeStart < strip.activeEnd && (float)strip.pixels[strip.activeStart] == 0.0f) { strip.activeStart++; }
+  while (strip.activeEnd > strip.activeStart && (float)strip.pixels[strip.activeEnd-1] == 0.0f) { strip.activeEnd--; }
+  if (strip.activeStart == strip.activeEnd) { strip.activeStart = strip.activeEnd = 0; }
+}
+
 static void fadePixel (const Controls& data, PixelStrip& strip, uint16_t idx, float fadeTime) {
   strip.pixels[idx] -= strip.dt / (fadeTime + 0.001f);
   strip.pixels[idx] = limit(strip.pixels[idx]);
 }
 void fadeAll(const Controls& data, PixelStrip& strip, float fadeTime) {
-  for (uint16_t i=0; i<strip.length; i++ ) {
+  for (uint16_t i=strip.activeStart; i<strip.activeEnd; i++ ) {
     fadePixel(data, strip, i, 2.0f*fadeTime);
   }
+  trimActive(strip);
 }
 
-static void fizzlePixel (const Controls& data, PixelStrip& strip, uint16_t idx, float fizzleTime) {
-  fizzleTime = (0.25f + 2.0f*fizzleTime) * (float)(rand()%1000) / 1000.0f;
+static void fizzlePixel (const Controls& data, PixelStrip& strip, uint16_t idx, float fizzleTime, float rnd) {
+  fizzleTime = (0.25f + 2.0f*fizzleTime) * rnd;
   strip.pixels[idx] -= strip.dt / (fizzleTime + 0.001f);
   strip.pixels[idx] = limit(strip.pixels[idx]);
 }
 void fizzleAll(const Controls& data, PixelStrip& strip, float fizzleTime) {
-  for (uint16_t i=0; i<strip.length; i++ ) {
-    fizzlePixel(data, strip, i, 2.0f*fizzleTime);
+  const uint16_t chunkSize = 64;
+  float rnd[chunkSize];
+  for (uint16_t start=strip.activeStart; start<strip.activeEnd; start+=chunkSize ) {
+    uint16_t count = (strip.activeEnd - start < chunkSize) ? strip.activeEnd - start : chunkSize;
+    strip.random.fill(rnd, count);
+    for (uint16_t i=0; i<count; i++ ) {
+      fizzlePixel(data, strip, start+i, 2.0f*fizzleTime, rnd[i]);
+    }
   }
+  trimActive(strip);
 }
 
-static float gradient (float lerp, float con, float smooth) {
+static float gradient (const PixelStrip& strip, float lerp, float con) {
   if (lerp < con) { lerp = 1.0f; } // Solid section
   else { lerp = 1.0f - (lerp - con)/(1.0f - con); } // Gradient sectioon
-  lerp = limit(lerp);
-  lerp = powerSmooth(lerp, smooth);
-  return lerp;
+  return smoothCurve(strip, lerp);
 }
 
-static void scroll(const Controls& data, PixelStrip& strip) {
-  float scrollDelta = data.smooth - strip.lastScrollPos;
-  if (scrollDelta > 0.5f) { scrollDelta -= 1.0f; }
-  if (scrollDelta < -0.5f) { scrollDelta += 1.0f; }
-  // If scrollDelta is small this frame, accumulate it
-  int16_t scrollSteps = (int16_t)(scrollDelta * (strip.length-1));
-  if (scrollSteps != 0) {
-    for (uint16_t i=0; i<strip.length; i++ ) {
-      strip.pixels[i] = strip.lastPixels[(strip.length + i - scrollSteps) % strip.length];
-    }
-    strip.lastScrollPos = data.smooth; // Only set when actually scrolled so that slow scrolling works
-  }
+// Modes that need the previous frame while writing the new one (wave) swap the buffers first,
+// so lastPixels holds the current state and every pixel of pixels gets rewritten. All other modes just
+// update pixels in place, so no per frame copy is needed.
+static void swapPixels(PixelStrip& strip) {
+  Pixel* temp = strip.pixels;
+  strip.pixels = strip.lastPixels;
+  strip.lastPixels = temp;
 }
 
+// Done in place, carrying the left neighbour's old value along, so it only has to visit one pixel either
+// side of the active range
 static void blur(const Controls& data, PixelStrip& strip, float blurRate) {
   float blurFactor = (blurRate + 0.02f) * strip.dt * 15.0f;
-  for (uint16_t i=0; i<strip.length; i++ ) {
-    float left = strip.lastPixels[(i < 1) ? 0 : i - 1];
-    float right = strip.lastPixels[(i+1 >= strip.length) ? strip.length-1 : i + 1];
-    float center = strip.lastPixels[i];
+  if (strip.activeStart >= strip.activeEnd) { return; }
+  uint16_t first = (strip.activeStart > 0) ? strip.activeStart - 1 : 0;
+  uint16_t end = (strip.activeEnd < strip.length) ? strip.activeEnd + 1 : strip.length;
+  float left = strip.pixels[(first < 1) ? 0 : first - 1];
+  for (uint16_t i=first; i<end; i++ ) {
+    float center = strip.pixels[i];
+    float right = strip.pixels[(i+1 >= strip.length) ? strip.length-1 : i + 1];
     float lDiff = left - center;
     float rDiff = right - center;
-    strip.pixels[i] += lDiff * blurFactor / 2.0f;
-    strip.pixels[i] += rDiff * blurFactor / 2.0f;
-    strip.pixels[i] = limit(strip.pixels[i]*(1.0f - strip.dt*0.1f));
+    float pixel = center + lDiff * blurFactor / 2.0f + rDiff * blurFactor / 2.0f;
+    strip.pixels[i] = limit(pixel*(1.0f - strip.dt*0.1f));
+    left = center;
   }
+  strip.activeStart = first;
+  strip.activeEnd = end;
+  trimActive(strip);
 }
 
+// Strips set up without velocity storage get a blur instead
 static void wave(const Controls& data, PixelStrip& strip, float spring, float damp=0.01f, float bounce=0.1f) {
+  if (strip.pixelVel == nullptr) {
+    blur(data, strip, 0.5f + 2.0f * spring);
+    return;
+  }
   spring = 1.0f + spring * 20.0f;
+  swapPixels(strip);
   for (uint16_t i=0; i<strip.length; i++ ) {
     float acc = 0.0f;
     if (i > 0) { acc += (strip.lastPixels[i-1] - strip.lastPixels[i]) * spring * 0.5f; }
@@ -93,48 +148,107 @@ static void wave(const Controls& data, PixelStrip& strip, float spring, float da
     strip.pixelVel[i] += acc * strip.dt;
   }
   for (uint16_t i=0; i<strip.length; i++ ) {
-    strip.pixels[i] += strip.pixelVel[i] * strip.dt;
-    if (strip.pixels[i] < 0.0f) {
-      strip.pixels[i] = 0.0f;
+    float pixel = strip.lastPixels[i] + strip.pixelVel[i] * strip.dt; // Pixel storage may clamp, so check for bounce before storing
+    if (pixel < 0.0f) {
+      pixel = 0.0f;
       strip.pixelVel[i] *= -bounce;
     }
-    if (strip.pixels[i] > 1.0f) {
-      strip.pixels[i] = 1.0f;
+    if (pixel > 1.0f) {
+      pixel = 1.0f;
       strip.pixelVel[i] *= -bounce;
     }
+    strip.pixels[i] = pixel;
   }
 }
 
-static void biScroll(const Controls& data, PixelStrip& strip, float direction=1.0f) {
+static void stopPixel(PixelStrip& strip, uint16_t i) {
+  if (strip.pixelVel != nullptr) { strip.pixelVel[i] = 0.0f; }
+}
+
+// Scrolling modes keep the strip as a ring buffer and only move a fractional read offset, so a scroll is O(1)
+// instead of a pass over the strip. The ring is resolved back into a straight strip, interpolating between
+// neighbouring pixels for smooth sub pixel motion, at output time.
+static uint16_t ringLength(const PixelStrip& strip) {
+  return (strip.ring == RingMirrored) ? (strip.length+1)/2 : strip.length;
+}
+
+static uint16_t ringPosition(const PixelStrip& strip, uint16_t idx) {
+  if (strip.ring == RingMirrored && idx >= ringLength(strip)) { return strip.length-1-idx; }
+  return idx;
+}
+
+static void scrollRing(const Controls& data, PixelStrip& strip, RingLayout layout, float direction) {
+  if (strip.ring != layout) {
+    strip.ring = layout;
+    strip.scrollOffset = 0.0f;
+    strip.lastScrollPos = data.smooth;
+  }
   float scrollDelta = (data.smooth - strip.lastScrollPos)*direction;
   if (scrollDelta > 0.5f) { scrollDelta -= 1.0f; }
   if (scrollDelta < -0.5f) { scrollDelta += 1.0f; }
-  // If scrollDelta is small this frame, accumulate it
-  int16_t scrollSteps = (int16_t)(scrollDelta * (strip.length-1));
-  if (scrollSteps != 0) {
-    for (uint16_t i=0; i<strip.length; i++ ) {
-      if (i < strip.length/2) {
-        strip.pixels[i] = strip.lastPixels[(strip.length + i - scrollSteps) % strip.length];
-      } else {
-        strip.pixels[i] = strip.lastPixels[(strip.length + i + scrollSteps) % strip.length];
-      }
-    }
-    strip.lastScrollPos = data.smooth; // Only set when actually scrolled so that slow scrolling works
+  float length = ringLength(strip);
+  strip.scrollOffset += scrollDelta * (strip.length-1);
+  while (strip.scrollOffset >= length) { strip.scrollOffset -= length; }
+  while (strip.scrollOffset < 0.0f) { strip.scrollOffset += length; }
+  strip.lastScrollPos = data.smooth;
+}
+
+static void scroll(const Controls& data, PixelStrip& strip) {
+  scrollRing(data, strip, RingForward, 1.0f);
+}
+
+static void biScroll(const Controls& data, PixelStrip& strip, float direction=1.0f) {
+  scrollRing(data, strip, RingMirrored, direction);
+}
+
+// Pixel to draw into for a position on the strip, taking account of any ring scrolling
+static Pixel& drawPixel(PixelStrip& strip, uint16_t idx) {
+  if (strip.ring == RingNone) { return strip.pixels[idx]; }
+  int32_t length = ringLength(strip);
+  int32_t pos = (int32_t)ringPosition(strip, idx) - (int32_t)(strip.scrollOffset + 0.5f);
+  if (pos < 0) { pos += length; }
+  return strip.pixels[pos];
+}
+
+// Write the ring out as a straight strip into out
+static void resolveRing(const PixelStrip& strip, Pixel* out) {
+  uint16_t length = ringLength(strip);
+  for (uint16_t i=0; i<strip.length; i++ ) {
+    float pos = (float)ringPosition(strip, i) - strip.scrollOffset;
+    if (pos < 0.0f) { pos += length; }
+    uint16_t idx = (uint16_t)pos;
+    if (idx >= length) { idx -= length; }
+    uint16_t next = (idx+1 >= length) ? 0 : idx+1;
+    float frac = pos - (float)(uint16_t)pos;
+    float a = strip.pixels[idx];
+    float b = strip.pixels[next];
+    out[i] = a + (b - a) * frac;
   }
 }
 
+// Put the strip back into straight order when leaving a scrolling mode
+static void unrollRing(PixelStrip& strip) {
+  resolveRing(strip, strip.lastPixels);
+  swapPixels(strip);
+  strip.ring = RingNone;
+  strip.scrollOffset = 0.0f;
+}
+
 static void drawLine(const Controls& data, PixelStrip& strip, float paletteDraw) {
   uint16_t lastDrawIdx = strip.lastDrawPos*(strip.length-1);
   uint16_t drawIdx = data.control*(strip.length-1);
   if (drawIdx < lastDrawIdx) {
     for (uint16_t i=drawIdx; i<=lastDrawIdx; i++ ) {
-      strip.pixels[i] = paletteDraw;
+      drawPixel(strip, i) = paletteDraw;
     }
   } else {
     for (uint16_t i=lastDrawIdx; i<=drawIdx; i++ ) {
-      strip.pixels[i] = paletteDraw;
+      drawPixel(strip, i) = paletteDraw;
     }
   }
+  if (strip.ring == RingNone) { // Scrolling modes always output the whole strip, so don't need the range
+    activate(strip, (drawIdx < lastDrawIdx) ? drawIdx : lastDrawIdx, (drawIdx < lastDrawIdx) ? lastDrawIdx : drawIdx);
+  }
   strip.lastDrawPos = data.control;
 }
 
@@ -161,9 +275,9 @@ static void blurMode(const Controls& data, PixelStrip& strip) {
 // 10: Solid: Blend entire strip through the palette based on control, smoothing does nothing
 static void solid(const Controls& data, PixelStrip& strip) {
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
+    float centre2 = strip.centreDistance[i]*strip.centreDistance[i];
     float value = data.control;
-    value += data.smooth * 16.0f * (0.03125f - std::pow(pos - 0.5f, 4.0f));
+    value += data.smooth * (0.5f - centre2*centre2); // 16*(1/32 - (pos-0.5)^4)
     value = limit(value);
     strip.pixels[i] = value;
   }
@@ -172,8 +286,7 @@ static void solid(const Controls& data, PixelStrip& strip) {
 // 11: Gradient: control sets start palette position, smoothing sets end palette position, blend between the two
 static void gradientMode(const Controls& data, PixelStrip& strip) {
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    strip.pixels[i] = lerp(data.control, data.smooth, pos);
+    strip.pixels[i] = lerp(data.control, data.smooth, strip.position[i]);
   }
 }
 
@@ -181,8 +294,9 @@ static void gradientMode(const Controls& data, PixelStrip& strip) {
 static void dropletMode(const Controls& data, PixelStrip& strip) {
   blur(data, strip, data.smooth);
   if (data.control > 0.5f && strip.lastDropletControl <= 0.5f) {
-    uint16_t dropPos = rand() % strip.length;
+    uint16_t dropPos = strip.random.nextBelow(strip.length);
     strip.pixels[dropPos] = 1.0f;
+    activate(strip, dropPos, dropPos);
   }
   strip.lastDropletControl = data.control;
 }
@@ -200,17 +314,22 @@ static void xorMode(const Controls& data, PixelStrip& strip) {
 
 // 20: Noise: Perlin noise. Control is seed. Smoothing is scale and octaves
 static void noiseMode(const Controls& data, PixelStrip& strip) {
-  for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    float value = perlin_octaves(0.5f+pos*(8.0f - data.smooth*7.0f), data.control, 4, 0.5f, 2.0f);
-    strip.pixels[i] = limit(value*(1.0f + data.smooth) + 0.5f);
+  const uint16_t chunkSize = 64;
+  float values[chunkSize];
+  float dx = strip.positionScale*(8.0f - data.smooth*7.0f);
+  for (uint16_t start=0; start<strip.length; start+=chunkSize ) {
+    uint16_t count = (strip.length - start < chunkSize) ? strip.length - start : chunkSize;
+    perlin_octaves_row(0.5f + start*dx, dx, data.control, 4, 0.5f, 2.0f, values, count);
+    for (uint16_t i=0; i<count; i++ ) {
+      strip.pixels[start+i] = limit(values[i]*(1.0f + data.smooth) + 0.5f);
+    }
   }
 }
 
 // 21: Sine: Sine waves. Control is phase, smoothing is wavelength
 static void sineMode(const Controls& data, PixelStrip& strip) {
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
+    float pos = strip.position[i];
     float value = (std::sin((pos - data.control) * (0.5f + data.smooth*8.0f) * 2.0f * 3.14159265f) + 1.0f) / 2.0f;
     strip.pixels[i] = value;
   }
@@ -219,7 +338,7 @@ static void sineMode(const Controls& data, PixelStrip& strip) {
 // 22. Saw: Saw waves. Control is phase, smoothing is wavelength
 static void sawMode(const Controls& data, PixelStrip& strip) {
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
+    float pos = strip.position[i];
     float freq = 1.0f + data.smooth*8.0f;
     float value = fmod(pos*freq - data.control + 0.5f, 1.0f);
     strip.pixels[i] = limit(value);
@@ -229,7 +348,7 @@ static void sawMode(const Controls& data, PixelStrip& strip) {
 // 23. Tri: Triangle waves. Control is phase, smoothing is wavelength
 static void triMode(const Controls& data, PixelStrip& strip) {
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
+    float pos = strip.position[i];
     float freq = 1.0f + data.smooth*8.0f;
     float value = fmod(pos*freq - data.control + 0.5f, 1.0f);
     value = (value < 0.5f) ? (value * 2.0f) : (1.0f - (value - 0.5f) * 2.0f);
@@ -239,40 +358,33 @@ static void triMode(const Controls& data, PixelStrip& strip) {
 
 // 50: StartGradient: solid bar rises from start of strip, control is length of bar, smooth is lerp power in rest of strip
 static void startGradient(const Controls& data, PixelStrip& strip) {
+  updateSmoothCurve(strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float lerp = (float)i / (float)(strip.length-1); // Position along strip
-    lerp = gradient(lerp, data.control, data.smooth);
-    strip.pixels[i] = lerp;
+    strip.pixels[i] = gradient(strip, strip.position[i], data.control);
   }
 }
 
 // 51: EndGradient: solid bar falls from end of strip, control is length of bar, smooth is lerp power in rest of strip
 static void endGradient(const Controls& data, PixelStrip& strip) {
+  updateSmoothCurve(strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float lerp = (float)i / (float)(strip.length-1); // Position along strip
-    lerp = 1.0f - lerp; // Go from end
-    lerp = gradient(lerp, data.control, data.smooth);
-    strip.pixels[i] = lerp;
+    strip.pixels[i] = gradient(strip, 1.0f - strip.position[i], data.control); // Go from end
   }
 }
 
 // 52: MidGradient: solid bar expands from centre of strip, control is length of bar, smooth is lerp power in rest of strip
 static void midGradient(const Controls& data, PixelStrip& strip) {
+  updateSmoothCurve(strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float lerp = (float)i / (float)(strip.length-1); // Position along strip
-    lerp = std::abs(0.5f - lerp)*2.0f; // Go outwards from middle
-    lerp = gradient(lerp, data.control, data.smooth);
-    strip.pixels[i] = lerp;
+    strip.pixels[i] = gradient(strip, strip.centreDistance[i], data.control); // Go outwards from middle
   }
 }
 
 // 53. EndsGradient: solid bar expands from both ends of strip, control is length of bar, smooth is lerp power in rest of strip
 static void endsGradient(const Controls& data, PixelStrip& strip) {
+  updateSmoothCurve(strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float lerp = (float)i / (float)(strip.length-1); // Position along strip
-    lerp = 1.0f - std::abs(0.5f - lerp)*2.0f; // Go inwards from ends
-    lerp = gradient(lerp, data.control, data.smooth);
-    strip.pixels[i] = lerp;
+    strip.pixels[i] = gradient(strip, strip.endDistance[i], data.control); // Go inwards from ends
   }
 }
 
@@ -280,8 +392,7 @@ static void endsGradient(const Controls& data, PixelStrip& strip) {
 static void startFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (pos <= data.control) {
+    if (strip.position[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -291,8 +402,7 @@ static void startFade(const Controls& data, PixelStrip& strip) {
 static void endFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (pos > 1.0f - data.control) {
+    if (strip.position[i] > 1.0f - data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -302,8 +412,7 @@ static void endFade(const Controls& data, PixelStrip& strip) {
 static void midFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (std::abs(0.5f - pos)*2.0f <= data.control) {
+    if (strip.centreDistance[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -313,8 +422,7 @@ static void midFade(const Controls& data, PixelStrip& strip) {
 static void endsFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (1.0f - std::abs(0.5f - pos)*2.0f <= data.control) {
+    if (strip.endDistance[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -324,8 +432,7 @@ static void endsFade(const Controls& data, PixelStrip& strip) {
 static void startFizzle(const Controls& data, PixelStrip& strip) {
   fizzleAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (pos <= data.control) {
+    if (strip.position[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -335,8 +442,7 @@ static void startFizzle(const Controls& data, PixelStrip& strip) {
 static void endFizzle(const Controls& data, PixelStrip& strip) {
   fizzleAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (pos > 1.0f - data.control) {
+    if (strip.position[i] > 1.0f - data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -346,8 +452,7 @@ static void endFizzle(const Controls& data, PixelStrip& strip) {
 static void midFizzle(const Controls& data, PixelStrip& strip) {
   fizzleAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (std::abs(0.5f - pos)*2.0f <= data.control) {
+    if (strip.centreDistance[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -357,8 +462,7 @@ static void midFizzle(const Controls& data, PixelStrip& strip) {
 static void endsFizzle(const Controls& data, PixelStrip& strip) {
   fizzleAll(data, strip, data.smooth);
   for (uint16_t i=0; i<strip.length; i++ ) {
-    float pos = (float)i / (float)(strip.length-1);
-    if (1.0f - std::abs(0.5f - pos)*2.0f <= data.control) {
+    if (strip.endDistance[i] <= data.control) {
       strip.pixels[i] = 1.0f;
     }
   }
@@ -393,84 +497,84 @@ static void endsBlur(const Controls& data, PixelStrip& strip) {
 static void startWave(const Controls& data, PixelStrip& strip) {
   wave(data, strip, data.smooth);
   strip.pixels[0] = data.control;
-  strip.pixelVel[0] = 0.0f;
+  stopPixel(strip, 0);
 }
 
 // 91. EndWave: pixel drawn at end of strip, control is palette entry of pixel, smooth is spring
 static void endWave(const Controls& data, PixelStrip& strip) {
   wave(data, strip, data.smooth);
   strip.pixels[strip.length-1] = data.control;
-  strip.pixelVel[strip.length-1] = 0.0f;
+  stopPixel(strip, strip.length-1);
 }
 
 // 92. MidWave: pixel drawn at centre of strip, control is palette entry of pixel, smooth is spring
 static void midWave(const Controls& data, PixelStrip& strip) {
   wave(data, strip, data.smooth);
   strip.pixels[strip.length/2] = data.control;
-  strip.pixelVel[strip.length/2] = 0.0f;
+  stopPixel(strip, strip.length/2);
 }
 
 // 93. EndsWave: pixels drawn at both ends of strip, control is palette entry of pixel, smooth is spring
 static void endsWave(const Controls& data, PixelStrip& strip) {
   wave(data, strip, data.smooth);
   strip.pixels[0] = data.control;
-  strip.pixelVel[0] = 0.0f;
+  stopPixel(strip, 0);
   strip.pixels[strip.length-1] = data.control;
-  strip.pixelVel[strip.length-1] = 0.0f;
+  stopPixel(strip, strip.length-1);
 }
 
 // 100. StartTicker: Control sets palette entry to draw at start of strip. Smoothing is scroll pos
 static void startTicker(const Controls& data, PixelStrip& strip) {
-  strip.pixels[0] = data.control;
   scroll(data, strip);
+  drawPixel(strip, 0) = data.control;
 }
 
 // 101. EndTicker: Control sets palette entry to draw at end of strip. Smoothing is scroll pos
 static void endTicker(const Controls& data, PixelStrip& strip) {
-  strip.pixels[strip.length-1] = data.control;
   scroll(data, strip);
+  drawPixel(strip, strip.length-1) = data.control;
 }
 
 // 102. MidTicker: Control sets palette entry to draw at mid of strip. Smoothing is scroll pos, but moving out both ways
 static void midTicker(const Controls& data, PixelStrip& strip) {
-  strip.pixels[strip.length/2] = data.control;
   biScroll(data, strip, -1.0f);
+  drawPixel(strip, strip.length/2) = data.control;
 }
 
 // 103. EndsTicker: Control sets palette entry to draw at both ends of strip. Smoothing is scroll pos, but moving in both ways
 static void endsTicker(const Controls& data, PixelStrip& strip) {
-  strip.pixels[0] = data.control;
-  strip.pixels[strip.length-1] = data.control;
   biScroll(data, strip);
+  drawPixel(strip, 0) = data.control;
+  drawPixel(strip, strip.length-1) = data.control;
 }
 
 // 110. StartTickerFade: Control sets palette entry to draw at start of strip. Smoothing is scroll pos. A fixed slow fade is applied
 static void startTickerFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, 1.0f);
-  strip.pixels[0] = data.control;
   scroll(data, strip);
+  drawPixel(strip, 0) = data.control;
 }
 
 // 111. EndTickerFade: Control sets palette entry to draw at end of strip. Smoothing is scroll pos. A fixed slow fade is applied
 static void endTickerFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, 1.0f);
-  strip.pixels[strip.length-1] = data.control;
   scroll(data, strip);
+  drawPixel(strip, strip.length-1) = data.control;
 }
 
 // 112. MidTickerFade: Control sets palette entry to draw at mid of strip. Smoothing is scroll pos, but moving out both ways. A fixed slow fade is applied
 static void midTickerFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, 1.0f);
-  strip.pixels[strip.length/2] = data.control;
   biScroll(data, strip, -1.0f);
+  drawPixel(strip, strip.length/2) = data.control;
 }
 
 // 113. EndsTickerFade: Control sets palette entry to draw at both ends of strip. Smoothing is scroll pos, but moving in both ways. A fixed slow fade is applied
 static void endsTickerFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, 1.0f);
-  strip.pixels[0] = data.control;
-  strip.pixels[strip.length-1] = data.control;
   biScroll(data, strip);
+  drawPixel(strip, 0) = data.control;
+  drawPixel(strip, strip.length-1) = data.control;
 }
 
 // 150. Plot: Control sets plot pos. Smoothing is palette pos to plot at the plot pos.
@@ -484,6 +588,7 @@ void plotFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, data.smooth);
   uint16_t plotIdx = data.control*(strip.length-1);
   strip.pixels[plotIdx] = 1.0f;
+  activate(strip, plotIdx, plotIdx);
 }
 
 // 152. plotScrollFade: Control sets plot pos. Fore is drawn into the strip at plot pos. Smoothing is scroll pos. Fade time is fixed long.
@@ -491,7 +596,7 @@ void plotScrollFade(const Controls& data, PixelStrip& strip) {
   fadeAll(data, strip, 1.0f);
   scroll(data, strip);
   uint16_t plotIdx = data.control*(strip.length-1);
-  strip.pixels[plotIdx] = 1.0f;
+  drawPixel(strip, plotIdx) = 1.0f;
 }
 
 // 153: plotFizzle: Same as plot, but drawn pixels slowly fizzle back to back colour. Smoothing is fizzle time
@@ -499,6 +604,7 @@ void plotFizzle(const Controls& data, PixelStrip& strip) {
   fizzleAll(data, strip, data.smooth);
   uint16_t plotIdx = data.control*(strip.length-1);
   strip.pixels[plotIdx] = 1.0f;
+  activate(strip, plotIdx, plotIdx);
 }
 
 // 160: line: Same as Plot, but plot all pixels between last pos and new pos
@@ -525,83 +631,242 @@ void lineFizzle(const Controls& data, PixelStrip& strip) {
   drawLine(data, strip, 1.0f);
 }
 
-void updateStrip(const Controls& data, PixelStrip& strip, unsigned long timeNow) {
+// Every mode, with what it relies on. This is the one list of modes, for updateStrip, the benchmarks and the docs
+constexpr ModeInfo modeTable[] = {
+  // Background
+  { 0, "Fade", fadeMode, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  { 1, "Fizzle", fizzleMode, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  { 2, "Scroll", scrollMode, ModeReadsPrevious },
+  { 3, "Blur", blurMode, ModeReadsPrevious | ModeTimeDependent },
+  // Full strip
+  { 10, "Solid", solid, ModeStateless },
+  { 11, "Gradient", gradientMode, ModeStateless },
+  { 12, "Droplet", dropletMode, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  { 13, "Xor", xorMode, ModeReadsPrevious | ModeTimeDependent },
+  // Waveforms
+  { 20, "Noise", noiseMode, ModeStateless },
+  { 21, "Sine", sineMode, ModeStateless },
+  { 22, "Saw", sawMode, ModeStateless },
+  { 23, "Tri", triMode, ModeStateless },
+  // Meter gradient
+  { 50, "StartGradient", startGradient, ModeStateless },
+  { 51, "EndGradient", endGradient, ModeStateless },
+  { 52, "MidGradient", midGradient, ModeStateless },
+  { 53, "EndsGradient", endsGradient, ModeStateless },
+  // Meter fade
+  { 60, "StartFade", startFade, ModeReadsPrevious | ModeTimeDependent },
+  { 61, "EndFade", endFade, ModeReadsPrevious | ModeTimeDependent },
+  { 62, "MidFade", midFade, ModeReadsPrevious | ModeTimeDependent },
+  { 63, "EndsFade", endsFade, ModeReadsPrevious | ModeTimeDependent },
+  // Meter fizzle
+  { 70, "StartFizzle", startFizzle, ModeReadsPrevious | ModeTimeDependent },
+  { 71, "EndFizzle", endFizzle, ModeReadsPrevious | ModeTimeDependent },
+  { 72, "MidFizzle", midFizzle, ModeReadsPrevious | ModeTimeDependent },
+  { 73, "EndsFizzle", endsFizzle, ModeReadsPrevious | ModeTimeDependent },
+  // MeterBlur
+  { 80, "StartBlur", startBlur, ModeReadsPrevious | ModeTimeDependent },
+  { 81, "EndBlur", endBlur, ModeReadsPrevious | ModeTimeDependent },
+  { 82, "MidBlur", midBlur, ModeReadsPrevious | ModeTimeDependent },
+  { 83, "EndsBlur", endsBlur, ModeReadsPrevious | ModeTimeDependent },
+  // MeterWave
+  { 90, "StartWave", startWave, ModeReadsPrevious | ModeUsesVelocity | ModeTimeDependent },
+  { 91, "EndWave", endWave, ModeReadsPrevious | ModeUsesVelocity | ModeTimeDependent },
+  { 92, "MidWave", midWave, ModeReadsPrevious | ModeUsesVelocity | ModeTimeDependent },
+  { 93, "EndsWave", endsWave, ModeReadsPrevious | ModeUsesVelocity | ModeTimeDependent },
+  // Ticker
+  { 100, "StartTicker", startTicker, ModeReadsPrevious },
+  { 101, "EndTicker", endTicker, ModeReadsPrevious },
+  { 102, "MidTicker", midTicker, ModeReadsPrevious },
+  { 103, "EndsTicker", endsTicker, ModeReadsPrevious },
+  // TickerFade
+  { 110, "StartTickerFade", startTickerFade, ModeReadsPrevious | ModeTimeDependent },
+  { 111, "EndTickerFade", endTickerFade, ModeReadsPrevious | ModeTimeDependent },
+  { 112, "MidTickerFade", midTickerFade, ModeReadsPrevious | ModeTimeDependent },
+  { 113, "EndsTickerFade", endsTickerFade, ModeReadsPrevious | ModeTimeDependent },
+  // Plotting
+  { 150, "Plot", plot, ModeReadsPrevious },
+  { 151, "PlotFade", plotFade, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  { 152, "PlotScrollFade", plotScrollFade, ModeReadsPrevious | ModeTimeDependent },
+  { 153, "PlotFizzle", plotFizzle, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  // Line drawing
+  { 160, "Line", line, ModeReadsPrevious },
+  { 161, "LineFade", lineFade, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+  { 162, "LineScrollFade", lineScrollFade, ModeReadsPrevious | ModeTimeDependent },
+  { 163, "LineFizzle", lineFizzle, ModeReadsPrevious | ModeTimeDependent | ModeSparse },
+};
+constexpr uint8_t modeCount = sizeof(modeTable) / sizeof(modeTable[0]);
+
+// Position in modeTable for every mode id, modeCount where there's no mode. Built during static initialisation
+// like the Perlin table, so lookups are a single index from then on
+static uint8_t modeIndex[256];
+
+struct ModeIndexInit {
+  ModeIndexInit () {
+    for (uint16_t id=0; id<256; id++) { modeIndex[id] = modeCount; }
+    for (uint8_t i=0; i<modeCount; i++) { modeIndex[modeTable[i].id] = i; }
+  }
+};
+static ModeIndexInit modeIndexInited;
+
+const ModeInfo* findMode(uint8_t id) {
+  uint8_t i = modeIndex[id];
+  return (i < modeCount) ? &modeTable[i] : nullptr;
+}
+
+static uint32_t rotateLeft(uint32_t x, uint8_t bits) {
+  return (x << bits) | (x >> (32 - bits));
+}
+
+// MurmurHash3 style mixing step. Folding whole words straight into an FNV multiply only carries differences
+// upwards, so frames differing in only the high bits of some pixels (like 1.0 against 0.0) could collide
+static uint32_t hashWord(uint32_t hash, uint32_t word) {
+  word *= 0xcc9e2d51u;
+  word = rotateLeft(word, 15);
+  word *= 0x1b873593u;
+  hash ^= word;
+  return rotateLeft(hash, 13) * 5 + 0xe6546b64u;
+}
+
+static uint32_t floatBits(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+// Hash, a word at a time, of everything besides the pixel scalars that decides the output colours
+static uint32_t hashPalette(const Controls& data, const PixelStrip& strip) {
+  uint32_t hash = 2166136261u;
+  hash = hashWord(hash, data.palette);
+  hash = hashWord(hash, floatBits(data.back.red));
+  hash = hashWord(hash, floatBits(data.back.green));
+  hash = hashWord(hash, floatBits(data.back.blue));
+  hash = hashWord(hash, floatBits(data.fore.red));
+  hash = hashWord(hash, floatBits(data.fore.green));
+  hash = hashWord(hash, floatBits(data.fore.blue));
+  hash = hashWord(hash, outputLevelsGeneration());
+  hash = hashWord(hash, strip.outputLayout);
+  hash = hashWord(hash, presetTablesEnabled());
+  hash = hashWord(hash, gradientGeneration());
+  return hash;
+}
+
+// Only the active pixels, since everything outside them is 0
+static uint32_t hashPixels(const PixelStrip& strip, const Pixel* pixels) {
+  uint32_t hash = 2166136261u;
+  hash = hashWord(hash, strip.activeStart);
+  hash = hashWord(hash, strip.activeEnd);
+  const uint8_t* bytes = (const uint8_t*)(pixels + strip.activeStart);
+  uint32_t byteCount = (strip.activeEnd - strip.activeStart) * sizeof(Pixel);
+  uint32_t i = 0;
+  for (; i+4<=byteCount; i+=4) {
+    uint32_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = hashWord(hash, word);
+  }
+  for (; i<byteCount; i++) { hash = hashWord(hash, bytes[i]); }
+  return hash;
+}
+
+// The last frame written into the target, or null if it hasn't been written to lately
+static const WrittenTarget* findWritten(const PixelStrip& strip, const void* target) {
+  for (uint8_t i=0; i<2; i++) {
+    if (strip.written[i].target == target) { return &strip.written[i]; }
+  }
+  return nullptr;
+}
+
+static void recordWritten(PixelStrip& strip, const WrittenTarget& written) {
+  if (strip.written[0].target != written.target) { strip.written[1] = strip.written[0]; } // New target replaces the older one
+  strip.written[0] = written;
+}
+
+bool updateStrip(const Controls& data, PixelStrip& strip, uint64_t timeNow) {
+  if (strip.length == 0) { return false; } // Its buffers couldn't be allocated
   // Timing
   strip.dt = (float)(timeNow - strip.lastUpdateTime) / 1000000.0f; // delta time in seconds
   if (strip.dt > 0.1f) { strip.dt = 0.1f; }
   strip.lastUpdateTime = timeNow;
   // Apply mode and calculate new pixel scalar values
   uint8_t mode = data.mode;
-  if (mode != strip.lastMode) {
+  const ModeInfo* info = findMode(mode);
+  uint8_t flags = (info != nullptr) ? info->flags : 0;
+  bool modeChanged = mode != strip.lastMode;
+  if (modeChanged) {
     strip.lastMode = mode;
-    for (uint16_t i=0; i<strip.length; i++ ) { strip.pixelVel[i] = 0.0f; } // Reset vel on mode change
-  }
-  switch (mode) {
-    // Background
-    case 0: fadeMode(data, strip); break;
-    case 1: fizzleMode(data, strip); break;
-    case 2: scrollMode(data, strip); break;
-    case 3: blurMode(data, strip); break;
-    // Full strip
-    case 10: solid(data, strip); break;
-    case 11: gradientMode(data, strip); break;
-    case 12: dropletMode(data, strip); break;
-    case 13: xorMode(data, strip); break;
-    // Waveforms
-    case 20: noiseMode(data, strip); break;
-    case 21: sineMode(data, strip); break;
-    case 22: sawMode(data, strip); break;
-    case 23: triMode(data, strip); break;
-    // Meter gradient
-    case 50: startGradient(data, strip); break;
-    case 51: endGradient(data, strip); break;
-    case 52: midGradient(data, strip); break;
-    case 53: endsGradient(data, strip); break;
-    // Meter fade
-    case 60: startFade(data, strip); break;
-    case 61: endFade(data, strip); break;
-    case 62: midFade(data, strip); break;
-    case 63: endsFade(data, strip); break;
-    // Meter fizzle
-    case 70: startFizzle(data, strip); break;
-    case 71: endFizzle(data, strip); break;
-    case 72: midFizzle(data, strip); break;
-    case 73: endsFizzle(data, strip); break;
-    // MeterBlur
-    case 80: startBlur(data, strip); break;
-    case 81: endBlur(data, strip); break;
-    case 82: midBlur(data, strip); break;
-    case 83: endsBlur(data, strip); break;
-    // MeterWave
-    case 90: startWave(data, strip); break;
-    case 91: endWave(data, strip); break;
-    case 92: midWave(data, strip); break;
-    case 93: endsWave(data, strip); break;
-    // Ticker
-    case 100: startTicker(data, strip); break;
-    case 101: endTicker(data, strip); break;
-    case 102: midTicker(data, strip); break;
-    case 103: endsTicker(data, strip); break;
-    // TickerFade
-    case 110: startTickerFade(data, strip); break;
-    case 111: endTickerFade(data, strip); break;
-    case 112: midTickerFade(data, strip); break;
-    case 113: endsTickerFade(data, strip); break;
-    // Plotting
-    case 150: plot(data, strip); break;
-    case 151: plotFade(data, strip); break;
-    case 152: plotScrollFade(data, strip); break;
-    case 153: plotFizzle(data, strip); break;
-    // Line drawing
-    case 160: line(data, strip); break;
-    case 161: lineFade(data, strip); break;
-    case 162: lineScrollFade(data, strip); break;
-    case 163: lineFizzle(data, strip); break;
+    if (strip.ring != RingNone) {
+      if (flags & ModeStateless) { // About to be overwritten, so no need to put it back in order first
+        strip.ring = RingNone;
+        strip.scrollOffset = 0.0f;
+      } else {
+        unrollRing(strip);
+      }
+    }
+    if ((flags & ModeUsesVelocity) && strip.pixelVel != nullptr) {
+      for (uint16_t i=0; i<strip.length; i++ ) { strip.pixelVel[i] = 0.0f; } // Reset vel on mode change
+    }
+  }
+  // A stateless mode that doesn't move with time would render exactly the same pixels from the same controls
+  bool rerender = modeChanged || !strip.pixelHashValid || !(flags & ModeStateless) || (flags & ModeTimeDependent)
+    || data.control != strip.lastControl || data.smooth != strip.lastSmooth;
+  strip.lastControl = data.control;
+  strip.lastSmooth = data.smooth;
+  if (rerender && info != nullptr) {
+    StageTimer timer(strip.index, StageMode);
+    info->apply(data, strip);
+  }
+  if (!(flags & ModeSparse)) {
+    strip.activeStart = 0;
+    strip.activeEnd = strip.length;
   }
   // Apply palette and set colours
-  for (uint16_t i=0; i<strip.length; i++ ) {
-    strip.setPixel(i, palette(data.palette, data.back, data.fore, strip.pixels[i], strip.dt));
-    strip.lastPixels[i] = strip.pixels[i];
+  const Pixel* pixels = strip.pixels;
+  if (strip.ring != RingNone) {
+    StageTimer timer(strip.index, StageRing);
+    resolveRing(strip, strip.lastPixels); // lastPixels is free as scratch because scrolling modes don't use it
+    pixels = strip.lastPixels;
+  }
+  {
+    StageTimer timer(strip.index, StagePalette);
+    updatePaletteLut(strip.paletteLut, data.palette, data.back, data.fore);
+  }
+  StageTimer timer(strip.index, StageOutput);
+  WrittenTarget frame;
+  frame.target = strip.output != nullptr ? (const void*)strip.output : (const void*)strip.setPixel;
+  frame.paletteHash = hashPalette(data, strip);
+  if (rerender) {
+    strip.pixelHash = hashPixels(strip, pixels);
+    strip.pixelHashValid = true;
+  }
+  frame.hash = hashWord(frame.paletteHash, strip.pixelHash);
+  frame.activeStart = strip.activeStart;
+  frame.activeEnd = strip.activeEnd;
+  bool changed = !strip.frameHashValid || frame.hash != strip.frameHash || paletteIsRandom(data.palette);
+  strip.frameHash = frame.hash;
+  strip.frameHashValid = true;
+  const WrittenTarget* last = findWritten(strip, frame.target);
+  if (!changed && last != nullptr && last->hash == frame.hash) { return false; }
+  // Pixels that are 0 now and were 0 when the target was last written still have the right colour there, as long as
+  // the palette hasn't changed and doesn't randomise every pixel
+  uint16_t start = 0;
+  uint16_t end = strip.length;
+  if (last != nullptr && last->paletteHash == frame.paletteHash && !paletteIsRandom(data.palette)) {
+    start = frame.activeStart;
+    end = frame.activeEnd;
+    if (start >= end) {
+      start = last->activeStart;
+      end = last->activeEnd;
+    } else if (last->activeStart < last->activeEnd) {
+      if (last->activeStart < start) { start = last->activeStart; }
+      if (last->activeEnd > end) { end = last->activeEnd; }
+    }
+  }
+  if (strip.output != nullptr) {
+    outputStrip(strip, pixels, start, end);
+  } else if (strip.setPixel != nullptr) {
+    for (uint16_t i=start; i<end; i++ ) {
+      strip.setPixel(i, lookupPalette(strip.paletteLut, pixels[i], strip.dt, strip.random));
+    }
   }
+  recordWritten(strip, frame);
+  return changed;
 }
-
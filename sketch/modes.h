@@ -1,4 +1,10 @@
 #pragma once
+#include <stdint.h>
+#include <math.h>
+#include "random.h"
+#include "arena.h"
+
+// #define PIXEL_FIXED_POINT // Store pixel scalars and palette luts as 16 bit fixed point instead of float
 
 struct Rgb {
   float red;
@@ -12,30 +18,215 @@ struct Rgb {
   }
 };
 
+// 16 bit per channel colour, 0 to 65535 maps to 0.0 to 1.0
+struct Rgb16 {
+  uint16_t red;
+  uint16_t green;
+  uint16_t blue;
+  Rgb16 () { red=0; green=0; blue=0; }
+  Rgb16 (uint16_t _red, uint16_t _green, uint16_t _blue) {
+    red = _red;
+    green = _green;
+    blue = _blue;
+  }
+};
+
+#ifdef PIXEL_FIXED_POINT
+// Q0.16 pixel scalar. Converts to and from float so the modes can keep doing their maths in float,
+// but storage is halved and the palette and output stages can work on the raw integer value
+struct Pixel {
+  uint16_t q;
+  Pixel () { q = 0; }
+  Pixel (float v) { *this = v; }
+  operator float () const { return (float)q * (1.0f/65535.0f); }
+  Pixel& operator= (float v) {
+    if (!(v > 0.0f)) { q = 0; } // Also catches NaN
+    else if (v >= 1.0f) { q = 65535; }
+    else { q = (uint16_t)(v*65535.0f + 0.5f); }
+    return *this;
+  }
+  Pixel& operator+= (float v) { return *this = (float)*this + v; }
+  Pixel& operator-= (float v) { return *this = (float)*this - v; }
+};
+typedef Rgb16 PaletteEntry;
+#else
+typedef float Pixel;
+typedef Rgb PaletteEntry;
+#endif
+
+const uint16_t paletteLutSize = 256;
+const uint16_t smoothCurveSize = 256;
+
+// Palette sampled at evenly spaced lerp values, rebuilt only when the palette inputs change
+struct PaletteLut {
+  PaletteEntry* entries; // paletteLutSize+1 entries so the last segment can interpolate up to lerp 1.0
+  bool valid;
+  bool interpolate; // Step and dither palettes are discontinuous so use the nearest entry instead
+  uint8_t type;
+  Rgb back;
+  Rgb fore;
+  bool presetTables; // Which way the presets were built, so switching between table and formula rebuilds
+  uint32_t gradientGeneration; // Rebuilds when a gradient is uploaded
+  PaletteLut () {
+    entries = nullptr; // Set up by the owning strip
+    valid = false;
+    interpolate = true;
+    type = 0;
+    presetTables = true;
+    gradientGeneration = 0;
+  }
+};
+
+// Byte layouts for writing pixels straight into a driver's packed buffer
+enum PixelLayout {
+  LayoutGrb, // 3 bytes per pixel, WS2812 style
+  LayoutGrbw, // 4 bytes per pixel, SK6812 RGBW style with white extracted from the RGB
+  LayoutApa102 // 4 bytes per pixel, full global brightness then BGR
+};
+
+inline uint8_t bytesPerPixel(PixelLayout layout) {
+  return layout == LayoutGrb ? 3 : 4;
+}
+
+// How the scrolling modes are storing the strip as a ring buffer
+enum RingLayout {
+  RingNone, // Not scrolling, pixels maps straight onto the strip
+  RingForward, // Whole strip is one ring
+  RingMirrored // Ring covers half the strip, mirrored about the centre so it scrolls in or out from both ends
+};
+
+// An output target, along with what the last frame written into it left there
+struct WrittenTarget {
+  const void* target;
+  uint32_t hash; // Frame hash of the colours it holds
+  uint32_t paletteHash; // Hash of the palette inputs those colours were made with
+  uint16_t activeStart; // Outside this range it holds the colour for a 0 pixel
+  uint16_t activeEnd;
+  WrittenTarget () {
+    target = nullptr;
+    hash = 0;
+    paletteHash = 0;
+    activeStart = 0;
+    activeEnd = 0;
+  }
+};
+
 struct PixelStrip {
   uint16_t length;
-  float* pixels;
-  float* lastPixels;
+  Pixel* pixels;
+  Pixel* lastPixels;
   float* pixelVel;
-  unsigned long lastUpdateTime;
+  float positionScale; // 1/(length-1), so modes can multiply rather than divide to get the position along the strip
+  float* position; // Position along the strip, 0 at the start to 1 at the end
+  float* centreDistance; // 0 at the centre to 1 at the ends
+  float* endDistance; // 0 at the ends to 1 at the centre
+  float* smoothCurve; // smoothCurveSize+1 samples of the power curve used by the meter gradients
+  float smoothCurveParam; // The smooth value smoothCurve was built for, NaN when not built yet
+  uint64_t lastUpdateTime; // Microseconds
   float dt;
   uint8_t lastMode;
+  float lastControl; // Controls the pixels were last rendered from, so stateless modes can skip rendering the same again
+  float lastSmooth;
+  uint32_t pixelHash; // Hash of the pixels as last rendered
+  bool pixelHashValid;
   float lastScrollPos;
+  RingLayout ring;
+  float scrollOffset; // Fractional ring read offset in pixels
   float lastDrawPos;
   float lastDropletControl;
+  uint16_t activeStart; // Every pixel outside [activeStart, activeEnd) is 0, so the decay modes and output
+  uint16_t activeEnd; // can skip over them
+  uint16_t index; // Position in the engine, used for the PRNG seed and to file stage timings
+  Random random;
+  PaletteLut paletteLut;
   void (*setPixel) (uint16_t index, Rgb colour);
+  uint8_t* output; // When set, colours are written straight into this packed buffer instead of through setPixel
+  PixelLayout outputLayout;
+  uint32_t frameHash; // Hash of everything that decided the last frame's colours
+  bool frameHashValid;
+  WrittenTarget written[2]; // The last two output targets, so double buffered output can skip a strip when the slot
+                            // it's given already has this frame, or only write the part that differs
+  Arena* ownedArena; // Set when the strip allocated its own buffers, which go when the strip does
   PixelStrip (uint16_t _length, void (*_setPixel) (uint16_t index, Rgb colour)) {
-    length = _length;
-    pixels = new float[length] {0.0f};
-    lastPixels = new float[length] {0.0f};
-    pixelVel = new float[length] {0.0f};
+    initOwned(_length);
     setPixel = _setPixel;
+  }
+  PixelStrip (uint16_t _length, PixelLayout _outputLayout) {
+    initOwned(_length);
+    outputLayout = _outputLayout;
+  }
+  // Buffers from an arena that outlives the strip. Without velocity the wave modes fall back to blurring
+  PixelStrip (uint16_t _length, Arena& arena, bool velocity) {
+    ownedArena = nullptr;
+    initFromArena(_length, arena, velocity);
+  }
+  ~PixelStrip () { delete ownedArena; }
+  PixelStrip (const PixelStrip&) = delete;
+  PixelStrip& operator= (const PixelStrip&) = delete;
+  // Arena space the buffers for a strip take up
+  static uint32_t bufferBytes (uint16_t _length, bool velocity) {
+    return 2*Arena::bytesFor<Pixel>(_length) + (velocity ? Arena::bytesFor<float>(_length) : 0)
+      + Arena::bytesFor<PaletteEntry>(paletteLutSize+1) + Arena::bytesFor<float>(3*_length) + Arena::bytesFor<float>(smoothCurveSize+1);
+  }
+  // When the buffers can't be allocated the strip is left with no pixels, which updateStrip() won't touch
+  void initOwned (uint16_t _length) {
+    ownedArena = new Arena(bufferBytes(_length, true));
+    if (ownedArena->remaining() < bufferBytes(_length, true)) { _length = 0; }
+    initFromArena(_length, *ownedArena, true);
+  }
+  void initFromArena (uint16_t _length, Arena& arena, bool velocity) {
+    Pixel* _pixels = arena.alloc<Pixel>(_length);
+    Pixel* _lastPixels = arena.alloc<Pixel>(_length);
+    float* _pixelVel = velocity ? arena.alloc<float>(_length) : nullptr;
+    PaletteEntry* _lutEntries = arena.alloc<PaletteEntry>(paletteLutSize+1);
+    float* _positions = arena.alloc<float>(3*_length);
+    float* _smoothCurve = arena.alloc<float>(smoothCurveSize+1);
+    init(_length, _pixels, _lastPixels, _pixelVel, _lutEntries, _positions, _smoothCurve);
+  }
+  void init (uint16_t _length, Pixel* _pixels, Pixel* _lastPixels, float* _pixelVel, PaletteEntry* _lutEntries, float* _positions, float* _smoothCurve) {
+    length = _length;
+    pixels = _pixels;
+    lastPixels = _lastPixels;
+    pixelVel = _pixelVel;
+    paletteLut.entries = _lutEntries;
+    positionScale = (length > 1) ? 1.0f / (float)(length-1) : 0.0f;
+    position = _positions;
+    centreDistance = _positions + length;
+    endDistance = _positions + 2*length;
+    for (uint16_t i=0; i<length; i++ ) {
+      position[i] = (length > 1) ? (float)i / (float)(length-1) : 0.0f;
+      centreDistance[i] = (position[i] < 0.5f ? 0.5f - position[i] : position[i] - 0.5f)*2.0f;
+      endDistance[i] = 1.0f - centreDistance[i];
+    }
+    smoothCurve = _smoothCurve;
+    smoothCurveParam = NAN;
+    setPixel = nullptr;
+    output = nullptr;
+    outputLayout = LayoutGrb;
+    frameHash = 0;
+    frameHashValid = false;
+    for (uint8_t i=0; i<2; i++) { written[i] = WrittenTarget(); }
     lastUpdateTime = 0;
     dt = 0.0f;
     lastMode = 0;
+    lastControl = 0.0f;
+    lastSmooth = 0.0f;
+    pixelHash = 0;
+    pixelHashValid = false;
     lastScrollPos = 0.0f;
+    ring = RingNone;
+    scrollOffset = 0.0f;
     lastDrawPos = 0.0f;
     lastDropletControl = 0.0f;
+    activeStart = 0; // Buffers passed in might not be cleared, so assume all of it is lit until a decay finds otherwise
+    activeEnd = length;
+    setIndex(0);
+  }
+  // The strip's position in its engine, so the same layout always gets the same seeds and timing slots however
+  // many times it's been configured. Standalone strips stay at 0
+  void setIndex (uint16_t _index) {
+    index = _index;
+    random.seed(index + 1);
   }
 };
 
@@ -46,6 +237,7 @@ struct Controls {
   float smooth;
   Rgb back;
   Rgb fore;
+  Controls () : Controls(Rgb(), Rgb()) {}
   Controls (Rgb _back, Rgb _fore) {
     mode = 0;
     palette = 0;
@@ -56,4 +248,27 @@ struct Controls {
   }
 };
 
-void updateStrip(const Controls& data, PixelStrip& strip, unsigned long timeNow);
+// What a mode relies on, so updateStrip can skip the work it doesn't need
+enum ModeFlags {
+  ModeReadsPrevious = 1, // Builds on the last frame, so the pixels have to carry over from frame to frame and mode to mode
+  ModeUsesVelocity = 2, // Reads and writes pixelVel
+  ModeStateless = 4, // Rewrites every pixel from the controls alone
+  ModeTimeDependent = 8, // Changes with the time between frames even when the controls don't
+  ModeSparse = 16 // Only decays what's there and draws into a few pixels, so keeps the active range up to date
+};
+
+typedef void (*ModeFunction) (const Controls& data, PixelStrip& strip);
+
+struct ModeInfo {
+  uint8_t id; // The DMX mode channel value
+  const char* name;
+  ModeFunction apply;
+  uint8_t flags;
+};
+
+extern const ModeInfo modeTable[]; // In mode id order
+extern const uint8_t modeCount;
+const ModeInfo* findMode(uint8_t id); // Null for ids with no mode, which leave the pixels as they are
+
+// Returns whether the colours changed since the last frame, so unchanged strips don't need sending again
+bool updateStrip(const Controls& data, PixelStrip& strip, uint64_t timeNow);
@@ -0,0 +1,179 @@
+#include <cmath>
+#include <algorithm>
+#include "output.h"
+#include "palettes.h"
+
+uint8_t outputLut[outputLutSize];
+static bool outputLutValid = false;
+static float outputDimmer = 0.0f;
+static float outputGamma = 0.0f;
+static uint32_t outputGeneration = 0; // Bumped on every rebuild, so strips know their output is stale
+
+void setOutputLevels(float dmxDimmer, float dmxGamma) {
+  if (outputLutValid && dmxDimmer == outputDimmer && dmxGamma == outputGamma) { return; }
+  float dimmer = dmxDimmer == 0.0f ? 1.0f : dmxDimmer; // For convenience, the default dmx value of 0 is full-on. Otherwise you have to always set the global dimmer channel to do anything
+  float gamma = dmxGamma == 0.0f ? 1.25f : 0.25f+dmxGamma*3.75f; // For convenience, the default dmx value of 0 is gamma of 1.25. Otherwise you have to always set the global gamma channel to get useful output
+  for (uint16_t i=0; i<outputLutSize; i++) {
+    float v = (float)i / (float)(outputLutSize-1);
+    outputLut[i] = std::pow(v, gamma)*dimmer*255;
+  }
+  outputDimmer = dmxDimmer;
+  outputGamma = dmxGamma;
+  outputLutValid = true;
+  outputGeneration++;
+}
+
+uint32_t outputLevelsGeneration() {
+  return outputGeneration;
+}
+
+static inline void extractWhite(uint8_t& red, uint8_t& green, uint8_t& blue, uint8_t& white) {
+  white = std::min(std::min(red, green), blue);
+  red -= white; green -= white; blue -= white/4; // Account for W LED being yellowy compareed to RGB
+}
+
+void outputRgbw(const Rgb& colour, uint8_t& red, uint8_t& green, uint8_t& blue, uint8_t& white) {
+  red = outputChannel(colour.red);
+  green = outputChannel(colour.green);
+  blue = outputChannel(colour.blue);
+  extractWhite(red, green, blue, white);
+}
+
+void outputRgbw(const Rgb16& colour, uint8_t& red, uint8_t& green, uint8_t& blue, uint8_t& white) {
+  red = outputChannel(colour.red);
+  green = outputChannel(colour.green);
+  blue = outputChannel(colour.blue);
+  extractWhite(red, green, blue, white);
+}
+
+// Write pixels start to end-1 into the strip's packed output buffer, with one loop per layout so there is no per pixel dispatch.
+// Each pixel goes through the palette lookup and the output functions in turn, which the random palettes need
+void outputStripStaged(PixelStrip& strip, const Pixel* pixels, uint16_t start, uint16_t end) {
+  uint8_t* out = strip.output + start * bytesPerPixel(strip.outputLayout);
+  switch (strip.outputLayout) {
+    case LayoutGrb:
+      for (uint16_t i=start; i<end; i++ ) {
+        PaletteEntry colour = lookupPaletteEntry(strip.paletteLut, pixels[i], strip.dt, strip.random);
+        out[0] = outputChannel(colour.green);
+        out[1] = outputChannel(colour.red);
+        out[2] = outputChannel(colour.blue);
+        out += 3;
+      }
+      break;
+    case LayoutGrbw:
+      for (uint16_t i=start; i<end; i++ ) {
+        PaletteEntry colour = lookupPaletteEntry(strip.paletteLut, pixels[i], strip.dt, strip.random);
+        outputRgbw(colour, out[1], out[0], out[2], out[3]);
+        out += 4;
+      }
+      break;
+    case LayoutApa102:
+      for (uint16_t i=start; i<end; i++ ) {
+        PaletteEntry colour = lookupPaletteEntry(strip.paletteLut, pixels[i], strip.dt, strip.random);
+        out[0] = 0xff; // Global brightness at max, dimming is already in the output table
+        out[1] = outputChannel(colour.blue);
+        out[2] = outputChannel(colour.green);
+        out[3] = outputChannel(colour.red);
+        out += 4;
+      }
+      break;
+  }
+}
+
+// --- Fused Output ---
+// The same steps as outputStripStaged, but inlined into one loop per layout and palette kind: the lut read, the
+// interpolation, gamma and white extraction all happen in locals, with no calls or Rgb temporaries per pixel.
+// It has to give exactly the same bytes, so the clamp, gamma and white extraction are the same inline helpers the
+// staged path uses, and the lut interpolation keeps lookupPaletteEntry's arithmetic and rounding
+
+#ifdef PIXEL_FIXED_POINT
+static inline uint16_t fusedLerp(uint16_t a, uint16_t b, int32_t frac) {
+  return (uint16_t)((int32_t)a + ((((int32_t)b - (int32_t)a) * frac) >> 8));
+}
+
+// One pixel's palette colour, straight through gamma into its three channel values
+template <bool Interpolate>
+static inline void fusedChannels(const PaletteEntry* entries, Pixel pixel, uint8_t& r, uint8_t& g, uint8_t& b) {
+  uint16_t q = pixel.q;
+  if (Interpolate) {
+    const PaletteEntry& left = entries[q >> 8];
+    const PaletteEntry& right = entries[(q >> 8) + 1];
+    int32_t frac = q & 255;
+    r = outputChannel(fusedLerp(left.red, right.red, frac));
+    g = outputChannel(fusedLerp(left.green, right.green, frac));
+    b = outputChannel(fusedLerp(left.blue, right.blue, frac));
+  } else {
+    const PaletteEntry& nearest = entries[((uint32_t)q + 128) >> 8];
+    r = outputChannel(nearest.red);
+    g = outputChannel(nearest.green);
+    b = outputChannel(nearest.blue);
+  }
+}
+#else
+// One pixel's palette colour, straight through gamma into its three channel values
+template <bool Interpolate>
+static inline void fusedChannels(const PaletteEntry* entries, Pixel pixel, uint8_t& r, uint8_t& g, uint8_t& b) {
+  float pos = outputLimit(pixel) * (float)paletteLutSize;
+  if (Interpolate) {
+    uint16_t idx = (uint16_t)pos;
+    if (idx >= paletteLutSize) { idx = paletteLutSize - 1; }
+    float frac = pos - (float)idx;
+    const PaletteEntry& left = entries[idx];
+    const PaletteEntry& right = entries[idx + 1];
+    r = outputChannel(left.red + (right.red - left.red) * frac);
+    g = outputChannel(left.green + (right.green - left.green) * frac);
+    b = outputChannel(left.blue + (right.blue - left.blue) * frac);
+  } else {
+    const PaletteEntry& nearest = entries[(uint16_t)(pos + 0.5f)];
+    r = outputChannel(nearest.red);
+    g = outputChannel(nearest.green);
+    b = outputChannel(nearest.blue);
+  }
+}
+#endif
+
+template <PixelLayout Layout, bool Interpolate>
+static void fusedLoop(const PaletteEntry* entries, const Pixel* pixels, uint8_t* out, uint16_t start, uint16_t end) {
+  for (uint16_t i=start; i<end; i++) {
+    uint8_t r, g, b;
+    fusedChannels<Interpolate>(entries, pixels[i], r, g, b);
+    switch (Layout) { // Resolved at compile time
+      case LayoutGrb:
+        out[0] = g;
+        out[1] = r;
+        out[2] = b;
+        out += 3;
+        break;
+      case LayoutGrbw:
+        extractWhite(r, g, b, out[3]);
+        out[0] = g;
+        out[1] = r;
+        out[2] = b;
+        out += 4;
+        break;
+      case LayoutApa102:
+        out[0] = 0xff;
+        out[1] = b;
+        out[2] = g;
+        out[3] = r;
+        out += 4;
+        break;
+    }
+  }
+}
+
+template <PixelLayout Layout>
+static void fusedLayout(const PaletteLut& lut, const Pixel* pixels, uint8_t* out, uint16_t start, uint16_t end) {
+  if (lut.interpolate) { fusedLoop<Layout, true>(lut.entries, pixels, out, start, end); }
+  else { fusedLoop<Layout, false>(lut.entries, pixels, out, start, end); }
+}
+
+void outputStrip(PixelStrip& strip, const Pixel* pixels, uint16_t start, uint16_t end) {
+  if (paletteIsRandom(strip.paletteLut.type)) { outputStripStaged(strip, pixels, start, end); return; } // Needs the strip's PRNG per pixel
+  uint8_t* out = strip.output + start * bytesPerPixel(strip.outputLayout);
+  switch (strip.outputLayout) {
+    case LayoutGrb: fusedLayout<LayoutGrb>(strip.paletteLut, pixels, out, start, end); break;
+    case LayoutGrbw: fusedLayout<LayoutGrbw>(strip.paletteLut, pixels, out, start, end); break;
+    case LayoutApa102: fusedLayout<LayoutApa102>(strip.paletteLut, pixels, out, start, end); break;
+  }
+}
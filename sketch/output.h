@@ -0,0 +1,30 @@
+#pragma once
+#include "modes.h"
+
+const uint8_t outputLutBits = 12;
+const uint16_t outputLutSize = 1 << outputLutBits;
+
+// Output transfer table from a 12 bit input level to the final 8 bit channel value, with gamma and dimmer applied
+extern uint8_t outputLut[outputLutSize];
+
+void setOutputLevels(float dmxDimmer, float dmxGamma);
+uint32_t outputLevelsGeneration();
+
+// Clamps to [0, 1], with NaN going to 0
+inline float outputLimit(float x) {
+  return (x > 0.0f) ? ((x < 1.0f) ? x : 1.0f) : 0.0f;
+}
+
+// Inline so the staged and fused output loops share them
+inline uint8_t outputChannel(float v) {
+  return outputLut[(uint16_t)(outputLimit(v)*(float)(outputLutSize-1) + 0.5f)];
+}
+
+inline uint8_t outputChannel(uint16_t v) {
+  return outputLut[((uint32_t)v*(outputLutSize-1) + 32768) >> 16]; // Rounds the same way as the float version
+}
+
+void outputRgbw(const Rgb& colour, uint8_t& red, uint8_t& green, uint8_t& blue, uint8_t& white);
+void outputRgbw(const Rgb16& colour, uint8_t& red, uint8_t& green, uint8_t& blue, uint8_t& white);
+void outputStrip(PixelStrip& strip, const Pixel* pixels, uint16_t start, uint16_t end); // Fused palette, gamma and byte packing
+void outputStripStaged(PixelStrip& strip, const Pixel* pixels, uint16_t start, uint16_t end); // One step at a time, for checking the fused path
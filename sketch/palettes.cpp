@@ -1,11 +1,8 @@
 #include <cmath>
 #include <algorithm>
 #include "palettes.h"
-#include "hsv.h"
-
-typedef Rgb (*BlendFunc)(const Rgb&, const Rgb&, float);
-
-static const Rgb off = Rgb(0,0,0);
+#include "presets.h"
+#include "gradients.h"
 
 static float limit (float x) {
   if (std::isnan(x)) { return 0.0f; }
@@ -14,8 +11,6 @@ static float limit (float x) {
   return x;
 }
 
-static Rgb blend3(const Rgb& a, const Rgb& b, const Rgb& c, float lerp, BlendFunc blend);
-
 static Rgb blendRgb (const Rgb& left, const Rgb& right, float lerp) {
     return Rgb(
       left.red + (right.red - left.red) * lerp,
@@ -24,244 +19,251 @@ static Rgb blendRgb (const Rgb& left, const Rgb& right, float lerp) {
     );
 }
 
-static Rgb step (const Rgb& left, const Rgb& right, float lerp) {
-    return (lerp < 0.5f) ? left : right;
+static Rgb blendRgb (const Stop& left, const Stop& right, float lerp) {
+    return blendRgb(left.rgb, right.rgb, lerp);
+}
+
+static Rgb blendHsv (const Stop& left, const Stop& right, float lerp) {
+    return blendHsv(left.hsv, right.hsv, lerp);
+}
+
+static Rgb blendOklab (const Stop& left, const Stop& right, float lerp) {
+    return blendOklab(left.lab, right.lab, lerp);
 }
 
-static Rgb channelBlend (const Rgb& left, const Rgb& right, float lerp) {
+static Rgb step (const Stop& left, const Stop& right, float lerp) {
+    return (lerp < 0.5f) ? left.rgb : right.rgb;
+}
+
+static Rgb channelBlend (const Stop& left, const Stop& right, float lerp) {
     return Rgb(
-      left.red + (right.red - left.red) * std::pow(lerp, 1.0f),
-      left.green + (right.green - left.green) * std::pow(lerp, 3.0f),
-      left.blue + (right.blue - left.blue) * std::pow(lerp, 0.33f)
+      left.rgb.red + (right.rgb.red - left.rgb.red) * std::pow(lerp, 1.0f),
+      left.rgb.green + (right.rgb.green - left.rgb.green) * std::pow(lerp, 3.0f),
+      left.rgb.blue + (right.rgb.blue - left.rgb.blue) * std::pow(lerp, 0.33f)
     );
 }
 
-static Rgb dither (const Rgb& left, const Rgb& right, float lerp) {
+static Rgb dither (const Stop& left, const Stop& right, float lerp) {
     float cmp = std::sin(lerp * 50.0f)*0.5f + 0.5f;
     if (lerp >= cmp) {
-      return right;
+      return right.rgb;
     } else {
-      return left;
+      return left.rgb;
     }
 }
 
-static Rgb blendScaledSum(const Rgb& left, const Rgb& right, float lerp) {
-  float sumRed = left.red + right.red;
-  float sumGreen = left.green + right.green;
-  float sumBlue = left.blue + right.blue;
+// Through a middle colour made per sample, which isn't worth converting into a Stop
+static Rgb blendRgbVia (const Rgb& left, const Rgb& middle, const Rgb& right, float lerp) {
+  if (lerp < 0.5f) { return blendRgb(left, middle, lerp*2.0f); }
+  return blendRgb(middle, right, (lerp - 0.5f)*2.0f);
+}
+
+static Rgb blendScaledSum(const Stop& left, const Stop& right, float lerp) {
+  float sumRed = left.rgb.red + right.rgb.red;
+  float sumGreen = left.rgb.green + right.rgb.green;
+  float sumBlue = left.rgb.blue + right.rgb.blue;
   float sumMax = std::max(sumRed, std::max(sumGreen, sumBlue));
   float scale = sumMax > 1.0f ? 1.0f / sumMax : 1.0f;
-  return blend3(left, Rgb(sumRed * scale, sumGreen * scale, sumBlue * scale), right, lerp, blendRgb);
+  return blendRgbVia(left.rgb, Rgb(sumRed * scale, sumGreen * scale, sumBlue * scale), right.rgb, lerp);
 }
 
-static Rgb blendSub(const Rgb& left, const Rgb& right, float lerp) {
+static Rgb blendSub(const Stop& left, const Stop& right, float lerp) {
   Rgb sub = Rgb(
-    limit(right.red - left.red),
-    limit(right.green - left.green),
-    limit(right.blue - left.blue)
+    limit(right.rgb.red - left.rgb.red),
+    limit(right.rgb.green - left.rgb.green),
+    limit(right.rgb.blue - left.rgb.blue)
   );
-  return blend3(left, sub, right, lerp, blendRgb);
+  return blendRgbVia(left.rgb, sub, right.rgb, lerp);
 }
 
-static Rgb blend3(const Rgb& a, const Rgb& b, const Rgb& c, float lerp, BlendFunc blend) {
-  if (lerp < 1.0f/2.0f) { return blend(a, b, lerp*2.0f); }
-  else { return blend(b, c, (lerp-1.0f/2.0f)*2.0f/1.0f); }
+// The nine stop layouts every back/fore family comes in, as the last digit of the palette number. A new layout
+// only needs adding here for every family to pick it up. visit is called with the layout's stops, so sampling one
+// colour and filling a whole lut share the table. False for a layout that doesn't exist
+template <class Visit>
+static bool withLayout(uint8_t layout, const Stop& off, const Stop& back, const Stop& fore, Visit& visit) {
+  switch (layout) {
+    case 0: visit(back, fore); return true; // BF
+    case 1: visit(off, back, fore); return true; // OBF
+    case 2: visit(back, fore, off); return true; // BFO
+    case 3: visit(back, off, fore); return true; // BOF
+    case 4: visit(off, fore, back); return true; // OFB
+    case 5: visit(back, fore, back, fore); return true; // BFBF
+    case 6: visit(back, fore, back, fore, back, fore); return true; // BFBFBF
+    case 7: visit(off, back, fore, back, fore); return true; // OBFBF
+    case 8: visit(off, back, fore, back, fore, back, fore); return true; // OBFBFBF
+  }
+  return false;
 }
 
-static Rgb blend4(const Rgb& a, const Rgb& b, const Rgb& c, const Rgb& d, float lerp, BlendFunc blend) {
-  if (lerp <= 1.0f/3.0f) { return blend(a, b, lerp*3.0f); }
-   else { return blend3(b, c, d, (lerp-1.0f/3.0f)*3.0f/2.0f, blend); }
+template <BlendFunc Blend>
+struct SampleLayout {
+  float lerp;
+  Rgb colour;
+  template <typename... Stops> void operator()(const Stops&... stops) { colour = blendStops<Blend>(lerp, stops...); }
+};
+
+template <BlendFunc Blend>
+static Rgb familyPalette(uint8_t layout, const Stop& off, const Stop& back, const Stop& fore, float lerp) {
+  SampleLayout<Blend> sample = { lerp, off.rgb };
+  withLayout(layout, off, back, fore, sample);
+  return sample.colour;
 }
 
-static Rgb blend5(const Rgb& a, const Rgb& b, const Rgb& c, const Rgb& d, const Rgb& e, float lerp, BlendFunc blend) {
-  if (lerp <= 1.0f/4.0f) { return blend(a, b, lerp*4.0f); }
-  else { return blend4(b, c, d, e, (lerp-1.0f/4.0f)*4.0f/3.0f, blend); }
+static float nonLinear(float x) {
+  return limit((x*x + x)/2.0f);
 }
 
-static Rgb blend6(const Rgb& a, const Rgb& b, const Rgb& c, const Rgb& d, const Rgb& e, const Rgb& f, float lerp, BlendFunc blend) {
-  if (lerp <= 1.0f/5.0f) { return blend(a, b, lerp*5.0f); }
-  else { return blend5(b, c, d, e, f, (lerp-1.0f/5.0f)*5.0f/4.0f, blend); }
-}
+static Random paletteRandom; // Only for calling palette() directly, strips use their own via the lut
 
-static Rgb blend7(const Rgb& a, const Rgb& b, const Rgb& c, const Rgb& d, const Rgb& e, const Rgb& f, const Rgb& g, float lerp, BlendFunc blend) {
-  if (lerp <= 1.0f/6.0f) { return blend(a, b, lerp*6.0f); }
-  else { return blend6(b, c, d, e, f, g, (lerp-1.0f/6.0f)*6.0f/5.0f, blend); }
+static float fizzle(float x, Random& random) {
+  float rnd = random.nextFloat();
+  return limit(x + (std::pow(rnd, 7.0f) - 0.5f) * 0.4f);
 }
 
-static Rgb rainbow(float lerp) {
-  return Rgb(
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f)),
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f + 4.0f * M_PI / 3.0f)),
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 2.0f * M_PI * 0.87f + 2.0f * M_PI / 3.0f))
-  );
+static Rgb wizzle(const Rgb& colour, float dt, Random& random) {
+  float chancePerSecondPerLed = 0.33f;
+  float chanceThisFrame = dt * chancePerSecondPerLed;
+  if (random.nextFloat() < chanceThisFrame) { return Rgb(1.0f, 1.0f, 1.0f); }
+  return colour;
 }
 
-static Rgb blackbody(float lerp) {
-  return Rgb(
-    std::pow(lerp, 0.2f)*std::pow(1.07f-lerp, 0.01f),
-    std::pow(lerp, 0.8f)*std::pow(1.05f-lerp, 0.01f),
-    std::pow(lerp, 2.0f)
-  );
+static Rgb paletteStops(uint8_t type, const Stop& off, const Stop& back, const Stop& fore, float lerp, float dt) {
+  lerp = limit(lerp);
+  uint8_t layout = type % 10;
+  switch (type / 10) {
+    case 0: return familyPalette<blendRgb>(layout, off, back, fore, lerp);
+    case 1: return familyPalette<blendHsv>(layout, off, back, fore, lerp);
+    case 2: return familyPalette<blendHsv>(layout, off, back, fore, nonLinear(lerp));
+    case 3: return familyPalette<blendScaledSum>(layout, off, back, fore, lerp);
+    case 4: return familyPalette<blendSub>(layout, off, back, fore, lerp);
+    case 5: return familyPalette<step>(layout, off, back, fore, lerp);
+    case 6: return familyPalette<channelBlend>(layout, off, back, fore, lerp);
+    case 7: return familyPalette<blendOklab>(layout, off, back, fore, lerp);
+    case 10: return familyPalette<dither>(layout, off, back, fore, lerp);
+    case 11: return (layout > 8) ? off.rgb : familyPalette<blendRgb>(layout, off, back, fore, fizzle(lerp, paletteRandom));
+    case 12: return (layout > 8) ? off.rgb : wizzle(familyPalette<blendRgb>(layout, off, back, fore, lerp), dt, paletteRandom);
+  }
+  if (isPreset(type)) { return presetColour(type, lerp); }
+  if (isGradient(type)) { return gradientColour(type, lerp); }
+  return off.rgb;
 }
 
-static Rgb oil(float lerp) {
-  lerp = 1.0f - lerp;
-  return Rgb(
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 17.0f)),
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 15.5)),
-    std::pow(lerp, 0.1f)*(0.5f + 0.5f * std::cos(lerp * 14.0f))
-  );
+Rgb palette(uint8_t type, const Rgb& back, const Rgb& fore, float lerp, float dt) {
+  return paletteStops(type, Stop(Rgb(0,0,0)), Stop(back), Stop(fore), lerp, dt);
 }
 
-static Rgb neon(float lerp) {
-  return Rgb(
-    std::pow(lerp, 0.3f)*limit(0.4f - 0.6f * std::cos(lerp * 0.75f * M_PI + 0.2f*M_PI)),
-    std::pow(lerp, 0.15f)*limit(0.4f + 0.6f * std::cos(lerp * 0.75f * M_PI + 0.1f*M_PI)),
-    std::pow(lerp, 0.1f)*limit(1.0f + 0.0f * std::cos(lerp * 1.9f * M_PI + 0.1f*M_PI))
-  );
+static bool sameRgb(const Rgb& a, const Rgb& b) {
+  return a.red == b.red && a.green == b.green && a.blue == b.blue;
 }
 
-static Rgb fire(float lerp) {
-  return Rgb(
-    std::pow(lerp, 0.2f),
-    std::pow(lerp, 0.8f)*0.9f,
-    std::pow(lerp, 2.0f)*0.3f
-  );
+// Fizzle and wizzle, which give different colours every frame even for the same pixel values
+bool paletteIsRandom(uint8_t type) {
+  return type >= 110 && type <= 128;
 }
 
-static Rgb heat(float lerp) {
-  return Rgb(
-    std::pow(lerp, 0.5f),
-    std::pow(lerp, 1.5f)*0.8f,
-    std::pow(lerp, 0.07f)/(1.0f+lerp)
-  );
+// The random palettes are random per pixel, so the lut holds their underlying RGB blend
+// and the randomness is applied at lookup time
+static uint8_t lutBaseType(uint8_t type) {
+  if (paletteIsRandom(type)) { return type % 10; }
+  return type;
 }
 
-static float nonLinear(float x) {
-  return limit((x*x + x)/2.0f);
+#ifdef PIXEL_FIXED_POINT
+static uint16_t toQ16(float x) { return (uint16_t)(limit(x)*65535.0f + 0.5f); }
+static PaletteEntry toEntry(const Rgb& colour) { return Rgb16(toQ16(colour.red), toQ16(colour.green), toQ16(colour.blue)); }
+static Rgb fromEntry(const PaletteEntry& entry) {
+  return Rgb((float)entry.red / 65535.0f, (float)entry.green / 65535.0f, (float)entry.blue / 65535.0f);
 }
-
-static float fizzle(float x) {
-  float rnd = (float)(rand()%1000) / 1000.0f;
-  return limit(x + (std::pow(rnd, 7.0f) - 0.5f) * 0.4f);
+static uint16_t lerpQ16(uint16_t a, uint16_t b, uint16_t frac) {
+  return (uint16_t)((int32_t)a + ((((int32_t)b - (int32_t)a) * (int32_t)frac) >> 8));
 }
+#else
+static PaletteEntry toEntry(const Rgb& colour) { return colour; }
+static Rgb fromEntry(const PaletteEntry& entry) { return entry; }
+#endif
+
+// A whole lut's worth of one layout, so the family and layout are picked once per rebuild rather than for every
+// sample, and each loop has its blend and stops fixed
+template <BlendFunc Blend, bool NonLinear>
+struct FillLayout {
+  PaletteEntry* entries;
+  template <typename... Stops> void operator()(const Stops&... stops) {
+    for (uint16_t i=0; i<=paletteLutSize; i++) {
+      float lerp = (float)i / (float)paletteLutSize;
+      entries[i] = toEntry(blendStops<Blend>(NonLinear ? nonLinear(lerp) : lerp, stops...));
+    }
+  }
+};
 
-static Rgb wizzle(const Rgb& colour, float dt) {
-  float chancePerSecondPerLed = 0.33f;
-  float chanceThisFrame = dt * chancePerSecondPerLed;
-  if (rand() % (unsigned int)(1.0f/chanceThisFrame) == 0) { return Rgb(1.0f, 1.0f, 1.0f); }
-  return colour;
+template <BlendFunc Blend, bool NonLinear = false>
+static bool fillFamily(PaletteEntry* entries, uint8_t layout, const Stop& off, const Stop& back, const Stop& fore) {
+  FillLayout<Blend, NonLinear> fill = { entries };
+  return withLayout(layout, off, back, fore, fill);
 }
 
-Rgb palette(uint8_t type, const Rgb& back, const Rgb& fore, float lerp, float dt) {
-  lerp = limit(lerp);
-  switch (type) {
-    case 0: return blendRgb(back, fore, lerp);
-    case 1: return blend3(off, back, fore, lerp, &blendRgb);
-    case 2: return blend3(back, fore, off, lerp, &blendRgb);
-    case 3: return blend3(back, off, fore, lerp, &blendRgb);
-    case 4: return blend3(off, fore, back, lerp, &blendRgb);
-    case 5: return blend4(back, fore, back, fore, lerp, &blendRgb);
-    case 6: return blend6(back, fore, back, fore, back, fore, lerp, &blendRgb);
-    case 7: return blend5(off, back, fore, back, fore, lerp, &blendRgb);
-    case 8: return blend7(off, back, fore, back, fore, back, fore, lerp, &blendRgb);
-
-    case 10: return blendHsv(back, fore, lerp);
-    case 11: return blend3(off, back, fore, lerp, &blendHsv);
-    case 12: return blend3(back, fore, off, lerp, &blendHsv);
-    case 13: return blend3(back, off, fore, lerp, &blendHsv);
-    case 14: return blend3(off, fore, back, lerp, &blendHsv);
-    case 15: return blend4(back, fore, back, fore, lerp, &blendHsv);
-    case 16: return blend6(back, fore, back, fore, back, fore, lerp, &blendHsv);
-    case 17: return blend5(off, back, fore, back, fore, lerp, &blendHsv);
-    case 18: return blend7(off, back, fore, back, fore, back, fore, lerp, &blendHsv);
-
-    case 20: return blendHsv(back, fore, nonLinear(lerp));
-    case 21: return blend3(off, back, fore, nonLinear(lerp), &blendHsv);
-    case 22: return blend3(back, fore, off, nonLinear(lerp), &blendHsv);
-    case 23: return blend3(back, off, fore, nonLinear(lerp), &blendHsv);
-    case 24: return blend3(off, fore, back, nonLinear(lerp), &blendHsv);
-    case 25: return blend4(back, fore, back, fore, nonLinear(lerp), &blendHsv);
-    case 26: return blend6(back, fore, back, fore, back, fore, nonLinear(lerp), &blendHsv);
-    case 27: return blend5(off, back, fore, back, fore, nonLinear(lerp), &blendHsv);
-    case 28: return blend7(off, back, fore, back, fore, back, fore, nonLinear(lerp), &blendHsv);
-
-    case 30: return blendScaledSum(back, fore, lerp);
-    case 31: return blend3(off, back, fore, lerp, &blendScaledSum);
-    case 32: return blend3(back, fore, off, lerp, &blendScaledSum);
-    case 33: return blend3(back, off, fore, lerp, &blendScaledSum);
-    case 34: return blend3(off, fore, back, lerp, &blendScaledSum);
-    case 35: return blend4(back, fore, back, fore, lerp, &blendScaledSum);
-    case 36: return blend6(back, fore, back, fore, back, fore, lerp, &blendScaledSum);
-    case 37: return blend5(off, back, fore, back, fore, lerp, &blendScaledSum);
-    case 38: return blend7(off, back, fore, back, fore, back, fore, lerp, &blendScaledSum);
-
-    case 40: return blendSub(back, fore, lerp);
-    case 41: return blend3(off, back, fore, lerp, &blendSub);
-    case 42: return blend3(back, fore, off, lerp, &blendSub);
-    case 43: return blend3(back, off, fore, lerp, &blendSub);
-    case 44: return blend3(off, fore, back, lerp, &blendSub);
-    case 45: return blend4(back, fore, back, fore, lerp, &blendSub);
-    case 46: return blend6(back, fore, back, fore, back, fore, lerp, &blendSub);
-    case 47: return blend5(off, back, fore, back, fore, lerp, &blendSub);
-    case 48: return blend7(off, back, fore, back, fore, back, fore, lerp, &blendSub);
-
-    case 50: return step(back, fore, lerp);
-    case 51: return blend3(off, back, fore, lerp, &step);
-    case 52: return blend3(back, fore, off, lerp, &step);
-    case 53: return blend3(back, off, fore, lerp, &step);
-    case 54: return blend3(off, fore, back, lerp, &step);
-    case 55: return blend4(back, fore, back, fore, lerp, &step);
-    case 56: return blend6(back, fore, back, fore, back, fore, lerp, &step);
-    case 57: return blend5(off, back, fore, back, fore, lerp, &step);
-    case 58: return blend7(off, back, fore, back, fore, back, fore, lerp, &step);
-
-    case 60: return channelBlend(back, fore, lerp);
-    case 61: return blend3(off, back, fore, lerp, &channelBlend);
-    case 62: return blend3(back, fore, off, lerp, &channelBlend);
-    case 63: return blend3(back, off, fore, lerp, &channelBlend);
-    case 64: return blend3(off, fore, back, lerp, &channelBlend);
-    case 65: return blend4(back, fore, back, fore, lerp, &channelBlend);
-    case 66: return blend6(back, fore, back, fore, back, fore, lerp, &channelBlend);
-    case 67: return blend5(off, back, fore, back, fore, lerp, &channelBlend);
-    case 68: return blend7(off, back, fore, back, fore, back, fore, lerp, &channelBlend);
-
-    case 100: return dither(back, fore, lerp);
-    case 101: return blend3(off, back, fore, lerp, &dither);
-    case 102: return blend3(back, fore, off, lerp, &dither);
-    case 103: return blend3(back, off, fore, lerp, &dither);
-    case 104: return blend3(off, fore, back, lerp, &dither);
-    case 105: return blend4(back, fore, back, fore, lerp, &dither);
-    case 106: return blend6(back, fore, back, fore, back, fore, lerp, &dither);
-    case 107: return blend5(off, back, fore, back, fore, lerp, &dither);
-    case 108: return blend7(off, back, fore, back, fore, back, fore, lerp, &dither);
+// The same families as paletteStops(), false for any other type
+static bool fillFamilyLut(PaletteEntry* entries, uint8_t type, const Stop& off, const Stop& back, const Stop& fore) {
+  uint8_t layout = type % 10;
+  switch (type / 10) {
+    case 0: return fillFamily<blendRgb>(entries, layout, off, back, fore);
+    case 1: return fillFamily<blendHsv>(entries, layout, off, back, fore);
+    case 2: return fillFamily<blendHsv, true>(entries, layout, off, back, fore);
+    case 3: return fillFamily<blendScaledSum>(entries, layout, off, back, fore);
+    case 4: return fillFamily<blendSub>(entries, layout, off, back, fore);
+    case 5: return fillFamily<step>(entries, layout, off, back, fore);
+    case 6: return fillFamily<channelBlend>(entries, layout, off, back, fore);
+    case 7: return fillFamily<blendOklab>(entries, layout, off, back, fore);
+    case 10: return fillFamily<dither>(entries, layout, off, back, fore);
+  }
+  return false;
+}
 
-    case 110: return blendRgb(back, fore, fizzle(lerp));
-    case 111: return blend3(off, back, fore, fizzle(lerp), &blendRgb);
-    case 112: return blend3(back, fore, off, fizzle(lerp), &blendRgb);
-    case 113: return blend3(back, off, fore, fizzle(lerp), &blendRgb);
-    case 114: return blend3(off, fore, back, fizzle(lerp), &blendRgb);
-    case 115: return blend4(back, fore, back, fore, fizzle(lerp), &blendRgb);
-    case 116: return blend6(back, fore, back, fore, back, fore, fizzle(lerp), &blendRgb);
-    case 117: return blend5(off, back, fore, back, fore, fizzle(lerp), &blendRgb);
-    case 118: return blend7(off, back, fore, back, fore, back, fore, fizzle(lerp), &blendRgb);
+void updatePaletteLut(PaletteLut& lut, uint8_t type, const Rgb& back, const Rgb& fore) {
+  if (lut.valid && lut.type == type && sameRgb(lut.back, back) && sameRgb(lut.fore, fore) && lut.presetTables == presetTablesEnabled()
+    && lut.gradientGeneration == gradientGeneration()) { return; }
+  uint8_t baseType = lutBaseType(type);
+  Stop offStop(Rgb(0,0,0));
+  Stop backStop(back);
+  Stop foreStop(fore);
+  if (isGradient(type)) { // Already sampled at the lut's lerps when it was uploaded
+    copyGradientLut(type, lut.entries);
+  } else if (!fillFamilyLut(lut.entries, baseType, offStop, backStop, foreStop)) {
+    for (uint16_t i=0; i<=paletteLutSize; i++) {
+      lut.entries[i] = toEntry(paletteStops(baseType, offStop, backStop, foreStop, (float)i / (float)paletteLutSize, 0.0f));
+    }
+  }
+  lut.interpolate = !((type >= 50 && type <= 58) || (type >= 100 && type <= 108) || gradientHasHardEdges(type));
+  lut.type = type;
+  lut.back = back;
+  lut.fore = fore;
+  lut.presetTables = presetTablesEnabled();
+  lut.gradientGeneration = gradientGeneration();
+  lut.valid = true;
+}
 
-    case 120: return wizzle(blendRgb(back, fore, lerp), dt);
-    case 121: return wizzle(blend3(off, back, fore, lerp, &blendRgb), dt);
-    case 122: return wizzle(blend3(back, fore, off, lerp, &blendRgb), dt);
-    case 123: return wizzle(blend3(back, off, fore, lerp, &blendRgb), dt);
-    case 124: return wizzle(blend3(off, fore, back, lerp, &blendRgb), dt);
-    case 125: return wizzle(blend4(back, fore, back, fore, lerp, &blendRgb), dt);
-    case 126: return wizzle(blend6(back, fore, back, fore, back, fore, lerp, &blendRgb), dt);
-    case 127: return wizzle(blend5(off, back, fore, back, fore, lerp, &blendRgb), dt);
-    case 128: return wizzle(blend7(off, back, fore, back, fore, back, fore, lerp, &blendRgb), dt);
+PaletteEntry lookupPaletteEntry(const PaletteLut& lut, Pixel value, float dt, Random& random) {
+  if (lut.type >= 110 && lut.type <= 118) { value = fizzle(value, random); }
+#ifdef PIXEL_FIXED_POINT
+  if (!lut.interpolate) { return lut.entries[(value.q + 128) >> 8]; }
+  uint16_t idx = value.q >> 8;
+  uint16_t frac = value.q & 255;
+  const Rgb16& a = lut.entries[idx];
+  const Rgb16& b = lut.entries[idx+1];
+  Rgb16 colour = Rgb16(lerpQ16(a.red, b.red, frac), lerpQ16(a.green, b.green, frac), lerpQ16(a.blue, b.blue, frac));
+  if (lut.type >= 120 && lut.type <= 128) { return toEntry(wizzle(fromEntry(colour), dt, random)); }
+  return colour;
+#else
+  float pos = limit(value) * (float)paletteLutSize;
+  if (!lut.interpolate) { return lut.entries[(uint16_t)(pos + 0.5f)]; }
+  uint16_t idx = (uint16_t)pos;
+  if (idx >= paletteLutSize) { idx = paletteLutSize - 1; }
+  float frac = pos - (float)idx;
+  Rgb colour = blendRgb(lut.entries[idx], lut.entries[idx+1], frac);
+  if (lut.type >= 120 && lut.type <= 128) { return wizzle(colour, dt, random); }
+  return colour;
+#endif
+}
 
-    case 240: return rainbow(lerp);
-    case 241: return blackbody(lerp);
-    case 242: return oil(lerp);
-    case 243: return neon(lerp);
-    case 244: return fire(lerp);
-    case 245: return heat(lerp);
-  }
-  return off;
+Rgb lookupPalette(const PaletteLut& lut, Pixel value, float dt, Random& random) {
+  return fromEntry(lookupPaletteEntry(lut, value, dt, random));
 }
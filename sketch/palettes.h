@@ -1,4 +1,43 @@
 #pragma once
 #include "modes.h"
+#include "colour.h"
+
+// A palette colour, converted up front into each colour space the blends work in. Palettes are sampled hundreds
+// of times per lut rebuild but only ever blend between off, back and fore, so those get converted once per rebuild
+struct Stop {
+  Rgb rgb;
+  Hsv hsv;
+  Oklab lab;
+  Stop (const Rgb& colour) : rgb(colour), hsv(rgbToHsv(colour)), lab(rgbToOklab(colour)) {}
+};
+
+typedef Rgb (*BlendFunc)(const Stop&, const Stop&, float);
+
+// Blend along any number of evenly spaced stops. The blend is a template argument rather than a pointer, so each
+// palette family gets its own copy with the blend called directly, and only once per sample
+inline void pickSegment(float, float&, const Stop*& left, const Stop*& right, const Stop& a, const Stop& b) {
+  left = &a; right = &b;
+}
+
+template <typename... Rest>
+inline void pickSegment(float pos, float& segment, const Stop*& left, const Stop*& right, const Stop& a, const Stop& b,
+    const Stop& c, const Rest&... rest) {
+  if (pos < segment + 1.0f) { left = &a; right = &b; return; }
+  segment += 1.0f;
+  pickSegment(pos, segment, left, right, b, c, rest...);
+}
+
+template <BlendFunc Blend, typename... Rest>
+inline Rgb blendStops(float lerp, const Stop& first, const Rest&... rest) {
+  float pos = lerp * (float)sizeof...(Rest), segment = 0.0f;
+  const Stop* left;
+  const Stop* right;
+  pickSegment(pos, segment, left, right, first, rest...);
+  return Blend(*left, *right, pos - segment);
+}
 
 Rgb palette(uint8_t type, const Rgb& back, const Rgb& fore, float lerp, float dt);
+bool paletteIsRandom(uint8_t type);
+void updatePaletteLut(PaletteLut& lut, uint8_t type, const Rgb& back, const Rgb& fore);
+PaletteEntry lookupPaletteEntry(const PaletteLut& lut, Pixel value, float dt, Random& random);
+Rgb lookupPalette(const PaletteLut& lut, Pixel value, float dt, Random& random);
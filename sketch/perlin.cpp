@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include "random.h"
 
 // --- Perlin Noise Implementation ---
 
@@ -9,11 +10,11 @@
 // We duplicate it to 512 to avoid having to use the modulo operator
 // (which is slow) when indexing.
 static int p[512];
-static bool inited = false;
 
 /**
  * @brief Initializes the permutation table with random values.
- * This should be called once at the beginning of your program.
+ * This runs once during static initialisation, before anything can call the noise functions from
+ * more than one thread, so the table is read only from then on.
  */
 static void perlin_init() {
     // Fill the first 256 entries with 0-255
@@ -21,12 +22,12 @@ static void perlin_init() {
         p[i] = i;
     }
 
-    // Seed the random number generator
-    srand(25332); // Fixed seed for reproducibility
+    // Our own generator rather than srand(), which would reseed rand() for everything else
+    Random random(25332); // Fixed seed for reproducibility
 
     // Shuffle the array using Fisher-Yates shuffle
     for (int i = 255; i > 0; i--) {
-        int j = rand() % (i + 1);
+        int j = random.nextBelow(i + 1);
         int temp = p[i];
         p[i] = p[j];
         p[j] = temp;
@@ -38,6 +39,11 @@ static void perlin_init() {
     }
 }
 
+struct PerlinInit {
+    PerlinInit() { perlin_init(); }
+};
+static PerlinInit perlin_inited;
+
 /**
  * @brief The "fade" function. This is a quintic polynomial 
  *        (6t^5 - 15t^4 + 10t^3) which has 0 first and second
@@ -151,11 +157,6 @@ float perlin_octaves(float x, float y, int octaves, float persistence, float lac
     float amplitude = 1.0f;
     float max_value = 0.0f; // Used for normalization
 
-    if (!inited) {
-        perlin_init();
-        inited = true;
-    }
-
     for (int i = 0; i < octaves; i++) {
         // Get the noise value for this octave
         total += perlin(x * frequency, y * frequency) * amplitude;
@@ -171,3 +172,92 @@ float perlin_octaves(float x, float y, int octaves, float persistence, float lac
     // Normalize the result to be in the range [-1.0, 1.0]
     return total / max_value;
 }
+
+
+/**
+ * @brief Works out the gradient contribution of lattice column X for a row
+ *        with constant y, already blended between the two Y lattice rows.
+ *        Every gradient is (+-1, +-1), so the blended contribution at
+ *        fractional x offset d is just slope*d + offset.
+ */
+static void row_column(int X, int Y, float yf, float v, float* slope, float* offset) {
+    int ha = p[p[X] + Y] & 7;
+    int hb = p[p[X] + Y + 1] & 7;
+    // Matches grad(): u is x for h<4 and y otherwise, v is the other one, h&1 flips u and h&2 flips v
+    float sxa = ((ha < 4) ? (ha & 1) : (ha & 2)) ? -1.0f : 1.0f;
+    float sya = ((ha < 4) ? (ha & 2) : (ha & 1)) ? -1.0f : 1.0f;
+    float sxb = ((hb < 4) ? (hb & 1) : (hb & 2)) ? -1.0f : 1.0f;
+    float syb = ((hb < 4) ? (hb & 2) : (hb & 1)) ? -1.0f : 1.0f;
+    *slope = lerp_perlin(v, sxa, sxb);
+    *offset = lerp_perlin(v, sya * yf, syb * (yf - 1.0f));
+}
+
+/**
+ * @brief Generates a row of multi-octave 2D Perlin noise at evenly spaced x
+ *        and constant y. Gives the same result as calling perlin_octaves()
+ *        for each x, but the y lattice work is done once per octave and
+ *        the x lattice cells are walked incrementally rather than hashed
+ *        and floored for every sample.
+ *
+ * @param x0 The x-coordinate of the first sample.
+ * @param dx The x spacing between samples.
+ * @param y The y-coordinate of the row.
+ * @param octaves, persistence, lacunarity As for perlin_octaves().
+ * @param out Receives count noise values in the range [-1.0, 1.0].
+ * @param count The number of samples.
+ */
+void perlin_octaves_row(float x0, float dx, float y, int octaves, float persistence, float lacunarity, float* out, int count) {
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    float max_value = 0.0f;
+
+    for (int i = 0; i < count; i++) {
+        out[i] = 0.0f;
+    }
+
+    for (int o = 0; o < octaves; o++) {
+        float yo = y * frequency;
+        int yi = (int)floorf(yo);
+        float yf = yo - (float)yi;
+        int Y = yi & 255;
+        float v = fade(yf);
+
+        float xs = x0 * frequency;
+        float step = dx * frequency;
+        int xi = (int)floorf(xs);
+        float leftSlope, leftOffset, rightSlope, rightOffset;
+        row_column(xi & 255, Y, yf, v, &leftSlope, &leftOffset);
+        row_column((xi + 1) & 255, Y, yf, v, &rightSlope, &rightOffset);
+        float scale = 1.4f * amplitude; // Same range scaling as perlin()
+
+        for (int i = 0; i < count; i++) {
+            float xf = (xs + step * (float)i) - (float)xi;
+            while (xf >= 1.0f) { // Walk into the next cell, reusing the old right edge as the new left edge
+                xi++;
+                xf -= 1.0f;
+                leftSlope = rightSlope;
+                leftOffset = rightOffset;
+                row_column((xi + 1) & 255, Y, yf, v, &rightSlope, &rightOffset);
+            }
+            while (xf < 0.0f) {
+                xi--;
+                xf += 1.0f;
+                rightSlope = leftSlope;
+                rightOffset = leftOffset;
+                row_column(xi & 255, Y, yf, v, &leftSlope, &leftOffset);
+            }
+            float left = leftSlope * xf + leftOffset;
+            float right = rightSlope * (xf - 1.0f) + rightOffset;
+            out[i] += lerp_perlin(fade(xf), left, right) * scale;
+        }
+
+        max_value += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    float normalise = 1.0f / max_value;
+    for (int i = 0; i < count; i++) {
+        out[i] *= normalise;
+    }
+}
@@ -1,3 +1,4 @@
 #pragma once
 
 float perlin_octaves(float x, float y, int octaves, float persistence, float lacunarity);
+void perlin_octaves_row(float x0, float dx, float y, int octaves, float persistence, float lacunarity, float* out, int count);
@@ -0,0 +1,88 @@
+#include "pipeline.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <thread>
+#endif
+
+static void waitBriefly () {
+#ifdef ARDUINO
+  vTaskDelay(1); // Let the idle task run, so the watchdog stays happy
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// Moves a slot from one state to another, returning false if it wasn't in the expected state
+static bool claimSlot (FramePipeline& pipeline, uint8_t slot, SlotState from, SlotState to) {
+  uint32_t expected = from;
+  return pipeline.state[slot].compare_exchange_strong(expected, to, std::memory_order_acquire);
+}
+
+uint8_t* FramePipeline::beginRender() {
+  while (!claimSlot(*this, renderSlot, SlotFree, SlotRendering)) { waitBriefly(); } // Slots are used in turn so frames stay in order
+  return slots[renderSlot];
+}
+
+void FramePipeline::endRender() {
+  state[renderSlot].store(SlotReady, std::memory_order_release);
+  renderSlot ^= 1;
+}
+
+const uint8_t* FramePipeline::beginSend() {
+  while (!claimSlot(*this, sendSlot, SlotReady, SlotSending)) {
+    if (!running.load()) { return nullptr; }
+    waitBriefly();
+  }
+  return slots[sendSlot];
+}
+
+void FramePipeline::endSend() {
+  state[sendSlot].store(SlotFree, std::memory_order_release);
+  sendSlot ^= 1;
+}
+
+struct OutputTask {
+  FramePipeline* pipeline;
+  SendFrame send;
+  void* context;
+};
+
+static void runOutputTask (OutputTask task) {
+  while (true) {
+    const uint8_t* frame = task.pipeline->beginSend();
+    if (frame == nullptr) { break; }
+    task.send(frame, task.context);
+    task.pipeline->endSend();
+  }
+}
+
+#ifdef ARDUINO
+static void outputTaskEntry (void* param) {
+  OutputTask* task = (OutputTask*)param;
+  runOutputTask(*task);
+  delete task;
+  vTaskDelete(NULL);
+}
+
+void startOutputTask(FramePipeline& pipeline, SendFrame send, void* context) {
+  OutputTask* task = new OutputTask {&pipeline, send, context};
+  BaseType_t core = xPortGetCoreID() == 0 ? 1 : 0;
+  xTaskCreatePinnedToCore(outputTaskEntry, "output", 4096, task, 2, NULL, core);
+}
+
+void stopOutputTask(FramePipeline& pipeline) {
+  pipeline.running = false; // The task deletes itself once it sees this
+}
+#else
+static std::thread outputThread;
+
+void startOutputTask(FramePipeline& pipeline, SendFrame send, void* context) {
+  outputThread = std::thread(runOutputTask, OutputTask {&pipeline, send, context});
+}
+
+void stopOutputTask(FramePipeline& pipeline) {
+  pipeline.running = false;
+  if (outputThread.joinable()) { outputThread.join(); }
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Double buffered handoff of packed output frames from a render task to an output task. One slot is rendered
+// into while the other is being sent, and the slot states are atomics so neither side ever takes a lock
+enum SlotState {
+  SlotFree, // Can be rendered into
+  SlotRendering,
+  SlotReady, // Holds a complete frame waiting to be sent
+  SlotSending
+};
+
+struct FramePipeline {
+  uint8_t* slots[2];
+  uint32_t frameBytes;
+  std::atomic<uint32_t> state[2];
+  std::atomic<bool> running;
+  uint8_t renderSlot; // Only touched by the render side
+  uint8_t sendSlot; // Only touched by the output side
+  FramePipeline (uint32_t _frameBytes) {
+    frameBytes = _frameBytes;
+    for (uint8_t i=0; i<2; i++) {
+      slots[i] = new uint8_t[frameBytes] {0};
+      state[i] = SlotFree;
+    }
+    running = true;
+    renderSlot = 0;
+    sendSlot = 0;
+  }
+  ~FramePipeline () { // The output task must have stopped
+    for (uint8_t i=0; i<2; i++) { delete[] slots[i]; }
+  }
+  FramePipeline (const FramePipeline&) = delete;
+  FramePipeline& operator= (const FramePipeline&) = delete;
+  uint8_t* beginRender(); // Waits for a free slot
+  void endRender();
+  const uint8_t* beginSend(); // Waits for a ready frame, returns nullptr once stopped
+  void endSend();
+};
+
+typedef void (*SendFrame) (const uint8_t* frame, void* context);
+
+// Runs send for every frame the render side publishes. On device it is a task pinned to the core loop() isn't on
+void startOutputTask(FramePipeline& pipeline, SendFrame send, void* context);
+void stopOutputTask(FramePipeline& pipeline);
@@ -0,0 +1,222 @@
+#include <cmath>
+#include "presets.h"
+
+// --- Compile Time Maths ---
+// C++11 constexpr functions are a single return statement, so the series are written as recursion.
+// Everything is in double so the tables come out as close to the runtime formulas as a float can hold.
+
+static constexpr double constPi = 3.14159265358979323846;
+static constexpr double constLn2 = 0.69314718055994530942;
+
+static constexpr double constSquare(double x) { return x * x; }
+
+static constexpr double constFloor(double x) {
+  return ((double)(long long)x > x) ? (double)(long long)x - 1.0 : (double)(long long)x;
+}
+
+/**
+ * @brief ln(m) for m in [1, 2) from the atanh series, 2 * sum z^(2k+1)/(2k+1) with z = (m-1)/(m+1).
+ *        z is at most 1/3, so 30 terms is well past double precision.
+ */
+static constexpr double constLnSeries(double z2, double term, int k) {
+  return (k > 30) ? 0.0 : term / (double)(2 * k + 1) + constLnSeries(z2, term * z2, k + 1);
+}
+
+static constexpr double constLnMantissa(double m) {
+  return 2.0 * constLnSeries(constSquare((m - 1.0) / (m + 1.0)), (m - 1.0) / (m + 1.0), 0);
+}
+
+/**
+ * @brief Natural log of a positive x, halving or doubling it into [1, 2) first.
+ */
+static constexpr double constLn(double x, int exponent) {
+  return (x >= 2.0) ? constLn(x / 2.0, exponent + 1)
+       : (x < 1.0) ? constLn(x * 2.0, exponent - 1)
+       : constLnMantissa(x) + (double)exponent * constLn2;
+}
+
+static constexpr double constExpSeries(double x, double term, int k) {
+  return (k > 25) ? 0.0 : term + constExpSeries(x, term * x / (double)(k + 1), k + 1);
+}
+
+/**
+ * @brief e^x by squaring e^(x/2) until x is small enough for the Taylor series.
+ */
+static constexpr double constExp(double x) {
+  return (x > 0.5 || x < -0.5) ? constSquare(constExp(x / 2.0)) : constExpSeries(x, 1.0, 0);
+}
+
+static constexpr double constPow(double x, double p) {
+  return (x <= 0.0) ? 0.0 : constExp(p * constLn(x, 0));
+}
+
+static constexpr double constCosSeries(double x2, double term, int k) {
+  return (k > 25) ? 0.0 : term + constCosSeries(x2, -term * x2 / (double)((2 * k + 1) * (2 * k + 2)), k + 1);
+}
+
+/**
+ * @brief cos(x) from the Taylor series, after wrapping x into [-pi, pi].
+ */
+static constexpr double constCos(double x) {
+  return constCosSeries(constSquare(x - 2.0 * constPi * constFloor(x / (2.0 * constPi) + 0.5)), 1.0, 0);
+}
+
+static constexpr double constLimit(double x) {
+  return (x < 0.0) ? 0.0 : (x > 1.0) ? 1.0 : x;
+}
+
+// The preset formulas are written once against these, so the tables and the exact path can't drift apart
+struct ConstMath {
+  static constexpr double pow(double x, double p) { return constPow(x, p); }
+  static constexpr double cos(double x) { return constCos(x); }
+};
+
+struct RuntimeMath {
+  static double pow(double x, double p) { return std::pow(x, p); }
+  static double cos(double x) { return std::cos(x); }
+};
+
+// --- Preset Formulas ---
+
+// Rgb has no constexpr constructor, so the tables hold this instead
+struct PresetColour {
+  float red;
+  float green;
+  float blue;
+};
+
+template <class M> constexpr double rainbowChannel(double lerp, double phase) {
+  return M::pow(lerp, 0.1) * (0.5 + 0.5 * M::cos(lerp * 2.0 * constPi * 0.87 + phase));
+}
+
+template <class M> constexpr PresetColour rainbow(double lerp) {
+  return PresetColour{
+    (float)rainbowChannel<M>(lerp, 0.0),
+    (float)rainbowChannel<M>(lerp, 4.0 * constPi / 3.0),
+    (float)rainbowChannel<M>(lerp, 2.0 * constPi / 3.0)
+  };
+}
+
+template <class M> constexpr PresetColour blackbody(double lerp) {
+  return PresetColour{
+    (float)(M::pow(lerp, 0.2) * M::pow(1.07 - lerp, 0.01)),
+    (float)(M::pow(lerp, 0.8) * M::pow(1.05 - lerp, 0.01)),
+    (float)M::pow(lerp, 2.0)
+  };
+}
+
+template <class M> constexpr double oilChannel(double lerp, double frequency) {
+  return M::pow(lerp, 0.1) * (0.5 + 0.5 * M::cos(lerp * frequency));
+}
+
+template <class M> constexpr PresetColour oil(double lerp) {
+  return PresetColour{
+    (float)oilChannel<M>(1.0 - lerp, 17.0),
+    (float)oilChannel<M>(1.0 - lerp, 15.5),
+    (float)oilChannel<M>(1.0 - lerp, 14.0)
+  };
+}
+
+template <class M> constexpr PresetColour neon(double lerp) {
+  return PresetColour{
+    (float)(M::pow(lerp, 0.3) * constLimit(0.4 - 0.6 * M::cos(lerp * 0.75 * constPi + 0.2 * constPi))),
+    (float)(M::pow(lerp, 0.15) * constLimit(0.4 + 0.6 * M::cos(lerp * 0.75 * constPi + 0.1 * constPi))),
+    (float)M::pow(lerp, 0.1)
+  };
+}
+
+template <class M> constexpr PresetColour fire(double lerp) {
+  return PresetColour{
+    (float)M::pow(lerp, 0.2),
+    (float)(M::pow(lerp, 0.8) * 0.9),
+    (float)(M::pow(lerp, 2.0) * 0.3)
+  };
+}
+
+template <class M> constexpr PresetColour heat(double lerp) {
+  return PresetColour{
+    (float)M::pow(lerp, 0.5),
+    (float)(M::pow(lerp, 1.5) * 0.8),
+    (float)(M::pow(lerp, 0.07) / (1.0 + lerp))
+  };
+}
+
+// --- Compile Time Tables ---
+
+template <uint16_t... I> struct Indices {};
+template <uint16_t N, uint16_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <uint16_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+struct PresetTable {
+  PresetColour entries[presetTableSize + 1];
+};
+
+template <PresetColour (*Formula)(double), uint16_t... I>
+constexpr PresetTable sampleTable(Indices<I...>) {
+  return PresetTable{{ Formula((double)I / (double)presetTableSize)... }};
+}
+
+typedef MakeIndices<presetTableSize + 1>::type PresetIndices;
+
+// constexpr so they are built by the compiler and live in flash, in the same order as the preset ids
+static constexpr PresetTable presetTables[presetCount] = {
+  sampleTable<rainbow<ConstMath>>(PresetIndices()),
+  sampleTable<blackbody<ConstMath>>(PresetIndices()),
+  sampleTable<oil<ConstMath>>(PresetIndices()),
+  sampleTable<neon<ConstMath>>(PresetIndices()),
+  sampleTable<fire<ConstMath>>(PresetIndices()),
+  sampleTable<heat<ConstMath>>(PresetIndices())
+};
+
+// --- Lookup ---
+
+static bool useTables = true;
+
+static Rgb toRgb(const PresetColour& colour) {
+  return Rgb(colour.red, colour.green, colour.blue);
+}
+
+bool isPreset(uint8_t type) {
+  return type >= presetFirst && type < presetFirst + presetCount;
+}
+
+Rgb presetTableColour(uint8_t type, float lerp) {
+  if (!isPreset(type)) { return Rgb(0, 0, 0); }
+  const PresetColour* entries = presetTables[type - presetFirst].entries;
+  float pos = lerp * (float)presetTableSize;
+  if (!(pos > 0.0f)) { return toRgb(entries[0]); } // Also catches NaN
+  if (pos >= (float)presetTableSize) { return toRgb(entries[presetTableSize]); }
+  uint16_t idx = (uint16_t)pos;
+  float frac = pos - (float)idx;
+  const PresetColour& a = entries[idx];
+  const PresetColour& b = entries[idx + 1];
+  return Rgb(
+    a.red + (b.red - a.red) * frac,
+    a.green + (b.green - a.green) * frac,
+    a.blue + (b.blue - a.blue) * frac
+  );
+}
+
+Rgb presetExactColour(uint8_t type, float lerp) {
+  switch (type) {
+    case 240: return toRgb(rainbow<RuntimeMath>(lerp));
+    case 241: return toRgb(blackbody<RuntimeMath>(lerp));
+    case 242: return toRgb(oil<RuntimeMath>(lerp));
+    case 243: return toRgb(neon<RuntimeMath>(lerp));
+    case 244: return toRgb(fire<RuntimeMath>(lerp));
+    case 245: return toRgb(heat<RuntimeMath>(lerp));
+  }
+  return Rgb(0, 0, 0);
+}
+
+Rgb presetColour(uint8_t type, float lerp) {
+  return useTables ? presetTableColour(type, lerp) : presetExactColour(type, lerp);
+}
+
+void setPresetTables(bool enabled) {
+  useTables = enabled;
+}
+
+bool presetTablesEnabled() {
+  return useTables;
+}
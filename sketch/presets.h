@@ -0,0 +1,14 @@
+#pragma once
+#include "modes.h"
+
+// Preset palettes 240-245, which don't use the back and fore colours at all
+const uint8_t presetFirst = 240;
+const uint8_t presetCount = 6;
+const uint16_t presetTableSize = paletteLutSize; // Samples are at the same lerps as the palette lut, plus one for lerp 1.0
+
+bool isPreset(uint8_t type);
+Rgb presetColour(uint8_t type, float lerp); // From the table or the formula, depending on setPresetTables()
+Rgb presetTableColour(uint8_t type, float lerp);
+Rgb presetExactColour(uint8_t type, float lerp);
+void setPresetTables(bool enabled); // On by default, off is only for checking the tables against the formulas
+bool presetTablesEnabled();
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+
+// Small xorshift PRNG. Each strip carries its own, so strips are independent of each other and of libc rand(),
+// and a render is reproducible from its seed
+struct Random {
+  uint32_t state;
+  Random () { seed(1); }
+  Random (uint32_t _seed) { seed(_seed); }
+  void seed (uint32_t _seed) {
+    state = _seed * 2654435761u ^ 0x9e3779b9u; // Spread out small seeds so neighbouring strips don't correlate
+    if (state == 0) { state = 0x9e3779b9u; } // xorshift must never have a zero state
+  }
+  uint32_t next () {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  // Uniform in [0, 1)
+  float nextFloat () { return (float)(next() >> 8) * (1.0f / 16777216.0f); }
+  // Uniform in [0, n), without a modulo
+  uint16_t nextBelow (uint16_t n) { return (uint16_t)(((uint64_t)next() * n) >> 32); }
+  void fill (float* out, uint16_t count) {
+    for (uint16_t i=0; i<count; i++) { out[i] = nextFloat(); }
+  }
+};
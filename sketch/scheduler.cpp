@@ -0,0 +1,56 @@
+#include "scheduler.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+uint64_t monotonicUs() {
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time();
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void sleepUntilUs(uint64_t deadline) {
+  uint64_t now = monotonicUs();
+  if (now >= deadline) { return; }
+#ifdef ARDUINO
+  uint64_t remaining = deadline - now;
+  if (remaining > 2000) { delay((remaining - 1000) / 1000); } // Yield to other tasks for whole ticks, leaving a margin for tick granularity
+  while (monotonicUs() < deadline) {} // Then spin for the remainder to hit the deadline precisely
+#else
+  std::this_thread::sleep_for(std::chrono::microseconds(deadline - now));
+#endif
+}
+
+void FrameScheduler::setFps(float fps) {
+  if (fps < 1.0f) { fps = 1.0f; }
+  periodUs = (uint32_t)(1000000.0f / fps);
+}
+
+uint64_t FrameScheduler::beginFrame() {
+  uint64_t now = monotonicUs();
+  if (frames == 0) { deadline = now; }
+  frames++;
+  return now;
+}
+
+void FrameScheduler::waitForNextFrame() {
+  deadline += periodUs;
+  uint64_t now = monotonicUs();
+  if (now > deadline) {
+    overruns++;
+    uint64_t late = now - deadline;
+    if (late >= periodUs) { // Skip the missed frames rather than rendering a burst to catch up
+      uint32_t missed = late / periodUs;
+      dropped += missed;
+      deadline += (uint64_t)missed * periodUs;
+    }
+    return;
+  }
+  sleepUntilUs(deadline);
+}
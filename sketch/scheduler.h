@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// Monotonic microseconds since boot (device) or an arbitrary epoch (host). 64 bit so it never wraps in practice
+uint64_t monotonicUs();
+void sleepUntilUs(uint64_t deadline);
+
+// Paces frames to a target rate by sleeping until each frame's deadline rather than for a fixed time after the work
+struct FrameScheduler {
+  uint32_t periodUs;
+  uint64_t deadline; // When the next frame should start
+  uint32_t frames;
+  uint32_t overruns; // Frames whose work ran past their deadline
+  uint32_t dropped; // Whole frame periods skipped because of overruns
+  FrameScheduler (float fps) {
+    setFps(fps);
+    deadline = 0;
+    frames = 0;
+    overruns = 0;
+    dropped = 0;
+  }
+  void setFps (float fps);
+  uint64_t beginFrame(); // Returns the frame time to render for
+  void waitForNextFrame();
+};
@@ -3,6 +3,13 @@
 #include <NeoPixelBus.h>
 #include <Dmx_ESP32.h>
 #include "modes.h"
+#include "engine.h"
+#include "output.h"
+#include "timing.h"
+#include "scheduler.h"
+#include "pipeline.h"
+#include "workers.h"
+#include "gradients.h"
 
 // Hardware Definitions for ESP32 DMX Shield (UART2)
 #define DMX_UART_NUM  2
@@ -29,50 +36,68 @@ typedef NeoPixelBus<NeoGrbwFeature, NeoEsp32I2s1X8Sk6812Method> NeoPixelStrip;
 // DMX
 uint16_t dmxStartChannel = 1; // Default to 1 but gets set from DIP switches
 
+// Frame pacing
+// #define PIPELINED_OUTPUT // Render the next frame on this core while an output task sends the last one on the other core
+// #define STRIP_WORKERS 1 // Extra tasks rendering strips in parallel with loop(), the strips are independent so this scales with cores
+#define TARGET_FPS 100
+#define KEEP_ALIVE_FRAMES TARGET_FPS // Resend unchanged strips about once a second, in case a pixel glitched
+FrameScheduler scheduler(TARGET_FPS);
+
 // Output color conversion
 static float dmxDimmer = 0.0f;
 static float dmxGamma = 0.0f;
-static float applyGamma (float v) {
-  float gammaValue = dmxGamma == 0.0f ? 1.25f : 0.25f+dmxGamma*3.75f; // For convenience, the default dmx value of 0 is gamma of 1.25. Otherwise you have to always set the global gamma channel to get useful output
-  return std::pow(v, gammaValue);
-}
-static uint8_t channel (float v) {
-  float dimmer = dmxDimmer == 0.0f ? 1.0f : dmxDimmer; // For convenience, the default dmx value of 0 is full-on. Otherwise you have to always set the global dimmer channel to do anything
-  return applyGamma(v)*dimmer*255;
+
+// Outputs in the order they are patched, up to maxStrips. Lengths and DMX footprints can differ per strip
+const StripConfig stripConfigs[] = {
+  // pin, length, DMX channels, back, fore, stateless
+  { LED_DATA0, 60, dmxStripChannels, Rgb(0.1f,0,0), Rgb(0.2f,0,0), false },
+  { LED_DATA1, 60, dmxStripChannels, Rgb(0,0.1f,0), Rgb(0,0.2f,0), false },
+  { LED_DATA2, 60, dmxStripChannels, Rgb(0,0,0.1f), Rgb(0,0,0.2f), false },
+};
+const uint8_t stripCount = sizeof(stripConfigs) / sizeof(stripConfigs[0]);
+static_assert(stripCount <= maxStrips, "More strips than the I2S x8 outputs");
+StripEngine engine(stripConfigs, stripCount, LayoutGrbw);
+NeoPixelStrip* neoStrips[maxStrips]; // Created in setup(), strips render straight into their buffers once the buses have begun
+
+// Only strips that changed are marked dirty. Whether Show() re-encodes a clean strip is down to the NeoPixelBus
+// method and version, so nothing here counts on it. The I2S x8 method clocks all eight channels out together on one
+// DMA, so a clean strip still costs its bus time whenever any strip is sent. Time is only saved when every strip is
+// clean and Show() isn't called at all
+static void showStrips (const bool* dirty) {
+  bool anyDirty = false;
+  for (uint8_t i=0; i<stripCount; i++) {
+    if (dirty[i]) { neoStrips[i]->Dirty(); } // Pixels were written directly into the buffers, so tell the buses to send them
+    anyDirty = anyDirty || dirty[i];
+  }
+  if (!anyDirty) { return; }
+  for (uint8_t i=0; i<stripCount; i++) {
+    StageTimer timer(engine.strips[i]->index, StageShow);
+    neoStrips[i]->Show();
+  }
 }
 
-static RgbColor toRgb (Rgb color, uint16_t index) { return RgbColor(channel(color.red), channel(color.green), channel(color.blue)); }
-static RgbwColor toRgbw (Rgb color, uint16_t index ) {
-  uint8_t red = channel(color.red);
-  uint8_t green = channel(color.green);
-  uint8_t blue = channel(color.blue);
-  // if (index%2 == 0) { return RgbwColor(255,255,255, 0); } // For testing RGB vs W balance
-  uint8_t white = std::min(std::min(red, green), blue);
-  red -= white; green -= white; blue -= white/4; // Account for W LED being yellowy compareed to RGB
-  return RgbwColor(red, green, blue, white);
+#ifdef PIPELINED_OUTPUT
+FramePipeline* pipeline; // Frames are packed strip after strip in the NeoPixelBus buffer layout, then a dirty flag per strip
+
+static void sendFrame (const uint8_t* frame, void*) {
+  const bool* dirty = (const bool*)(frame + engine.outputBytes);
+  for (uint8_t i=0; i<stripCount; i++) {
+    if (dirty[i]) { memcpy(neoStrips[i]->Pixels(), frame + engine.outputOffsets[i], neoStrips[i]->PixelsSize()); }
+  }
+  showStrips(dirty);
 }
+#endif
 
-// Strips
-const uint16_t pixelCount1 = 60;
-NeoPixelStrip neoStrip1(pixelCount1, LED_DATA0);
-static void setPixel1 (uint16_t index, Rgb color) { neoStrip1.SetPixelColor(index, toRgbw(color, index)); }
-PixelStrip pixelStrip1(pixelCount1, setPixel1);
-Controls controls1(Rgb(0.1f,0,0),Rgb(0.2f,0,0));
-
-const uint16_t pixelCount2 = 60;
-NeoPixelStrip neoStrip2(pixelCount2, LED_DATA1);
-static void setPixel2 (uint16_t index, Rgb color) { neoStrip2.SetPixelColor(index, toRgbw(color, index)); }
-PixelStrip pixelStrip2(pixelCount2, setPixel2);
-Controls controls2(Rgb(0,0.1f,0),Rgb(0,0.2f,0));
-
-const uint16_t pixelCount3 = 60;
-NeoPixelStrip neoStrip3(pixelCount3, LED_DATA2);
-static void setPixel3 (uint16_t index, Rgb color) { neoStrip3.SetPixelColor(index, toRgbw(color, index)); }
-PixelStrip pixelStrip3(pixelCount3, setPixel3);
-Controls controls3(Rgb(0,0,0.1f),Rgb(0,0,0.2f));
+static void printLine (const char* line) { Serial.println(line); }
 
 static void parseSerial (Controls& controls, String data) { // For testing
   Serial.println(data);
+  if (data.startsWith("t")) { // Stage timings as CSV, then the frame counts
+    dumpTiming(printLine);
+    Serial.printf("frames %lu overruns %lu dropped %lu\n", (unsigned long)scheduler.frames, (unsigned long)scheduler.overruns, (unsigned long)scheduler.dropped);
+  }
+  if (data.startsWith("T")) { resetTiming(); }
+  if (data.startsWith("f")) { scheduler.setFps(data.substring(1).toInt()); }
   if (data.startsWith("m")) { controls.mode = data.substring(1).toInt(); }
   if (data.startsWith("p")) { controls.palette = data.substring(1).toInt(); }
   if (data.startsWith("c")) { controls.control = ((float)data.substring(1).toInt())/255; }
@@ -83,6 +108,11 @@ static void parseSerial (Controls& controls, String data) { // For testing
   if (data.startsWith("R")) { controls.fore.red = ((float)data.substring(1).toInt())/255; }
   if (data.startsWith("G")) { controls.fore.green = ((float)data.substring(1).toInt())/255; }
   if (data.startsWith("B")) { controls.fore.blue = ((float)data.substring(1).toInt())/255; }
+  if (data.startsWith("u")) { // u<slot> pos:rrggbb[:blend] ... uploads gradient palette 200+slot
+    int space = data.indexOf(' ');
+    bool ok = setGradient(data.substring(1).toInt(), (space < 0) ? "" : data.c_str() + space + 1);
+    Serial.println(ok ? "Gradient set" : "Bad gradient");
+  }
 }
 
 static void parseDmx (Controls& controls, const uint16_t dmxStartChannel) {
@@ -114,37 +144,64 @@ void setup() {
                       + 128*(digitalRead(DIP_PIN_128)==LOW) + 256*(digitalRead(DIP_PIN_256)==LOW);
   Serial.printf("DIP switch dmxStartChannel: %d\n", dmxStartChannel);
 
+  setOutputLevels(dmxDimmer, dmxGamma);
+
   if (!dmxReceive.configure()) { Serial.println("DMX Configure failed."); }
   else { Serial.println("DMX Configured."); }
   delay(10);
   if (dmxReceive.start()) { Serial.println("DMX reception Started"); }
   else { Serial.println("DMX aborted"); }
 
-  neoStrip1.Begin(); neoStrip1.Show(); // Clear strip
-  neoStrip2.Begin(); neoStrip2.Show(); // Clear strip
-  neoStrip3.Begin(); neoStrip3.Show(); // Clear strip
+  if (engine.count != stripCount) { // The layout didn't fit in memory, so there are no strip buffers to render into
+    Serial.println("Strip layout too big for memory, halting.");
+    while (true) { delay(1000); }
+  }
+  for (uint8_t i=0; i<stripCount; i++) {
+    neoStrips[i] = new NeoPixelStrip(stripConfigs[i].length, stripConfigs[i].pin);
+    neoStrips[i]->Begin(); neoStrips[i]->Show(); // Clear strip
+  }
+  Serial.printf("%d strips, %lu output bytes\n", stripCount, (unsigned long)engine.outputBytes);
+#ifdef PIPELINED_OUTPUT
+  pipeline = new FramePipeline(engine.outputBytes + maxStrips);
+  startOutputTask(*pipeline, sendFrame, nullptr);
+#else
+  for (uint8_t i=0; i<stripCount; i++) { engine.strips[i]->output = neoStrips[i]->Pixels(); }
+#endif
+
+  engine.keepAliveFrames = KEEP_ALIVE_FRAMES;
+#ifdef STRIP_WORKERS
+  startWorkers(STRIP_WORKERS);
+#endif
 
   Serial.println("Setup complete.");
 }
 
+static void pollDmx () {
+  if (!dmxReceive.hasUpdated()) { return; } // only read new values
+  for (uint8_t i=0; i<stripCount; i++) { parseDmx(engine.controls[i], dmxStartChannel + engine.dmxOffsets[i]); }
+  // Serial.printf("DMX frame. Mode: %d Palette: %d Control: %.2f Smooth: %.2f\n", engine.controls[0].mode, engine.controls[0].palette, engine.controls[0].control, engine.controls[0].smooth);
+  dmxDimmer = ((float)dmxReceive.read(dmxStartChannel + engine.dmxGlobalOffset + 0))/255;
+  dmxGamma = ((float)dmxReceive.read(dmxStartChannel + engine.dmxGlobalOffset + 1))/255;
+  setOutputLevels(dmxDimmer, dmxGamma);
+}
+
 void loop() {
-  if (Serial.available()) { parseSerial(controls1, Serial.readString()); }
-
-  if (dmxReceive.hasUpdated()) {  // only read new values
-    parseDmx(controls1, dmxStartChannel + 0);
-    parseDmx(controls2, dmxStartChannel + 10);
-    parseDmx(controls3, dmxStartChannel + 20);
-    // Serial.printf("DMX frame. Mode: %d Palette: %d Control: %.2f Smooth: %.2f\n", controls1.mode, controls1.palette, controls1.control, controls1.smooth);
-    dmxDimmer = ((float)dmxReceive.read(dmxStartChannel + 30))/255;
-    dmxGamma = ((float)dmxReceive.read(dmxStartChannel + 31))/255;
+  {
+    StageTimer frameTimer(timingGlobal, StageFrame); // Just the work, not the wait for the next frame
+    if (Serial.available()) { parseSerial(engine.controls[0], Serial.readString()); }
+    { StageTimer timer(timingGlobal, StageDmx); pollDmx(); }
+
+    uint64_t us = scheduler.beginFrame();
+#ifdef PIPELINED_OUTPUT
+    uint8_t* frame = pipeline->beginRender();
+    engine.setOutputFrame(frame);
+    engine.render(us); // Returns once every strip is rendered
+    memcpy(frame + engine.outputBytes, engine.dirty, stripCount);
+    pipeline->endRender();
+#else
+    engine.render(us);
+    showStrips(engine.dirty);
+#endif
   }
-
-  unsigned long us = micros();
-  updateStrip(controls1, pixelStrip1, us);
-  updateStrip(controls2, pixelStrip2, us);
-  updateStrip(controls3, pixelStrip3, us);
-  neoStrip1.Show();
-  neoStrip2.Show();
-  neoStrip3.Show();
-  delay(10);
+  scheduler.waitForNextFrame();
 }
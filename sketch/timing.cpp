@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include "timing.h"
+
+// Log2 histogram with a half step per bucket, plus running min and total for the average
+struct TimingHistogram {
+  uint16_t buckets[timingBuckets];
+  uint32_t count;
+  uint64_t total;
+  uint32_t min;
+  uint32_t lastMin; // Min from before the last decay, so min doesn't jump up straight after decaying
+};
+
+static TimingHistogram histograms[timingStrips+1][stageCount];
+
+static TimingHistogram& histogramFor (uint16_t slot, Stage stage) {
+  return histograms[slot == timingGlobal ? timingStrips : slot % timingStrips][stage];
+}
+
+static uint8_t bucketFor (uint32_t ticks) {
+  if (ticks < 2) { return ticks; }
+  uint8_t msb = 31 - __builtin_clz(ticks);
+  return msb*2 + ((ticks >> (msb-1)) & 1);
+}
+
+static uint32_t bucketUpperEdge (uint8_t bucket) {
+  if (bucket < 2) { return bucket; }
+  uint8_t msb = bucket / 2;
+  uint32_t lower = (uint32_t)(2 + (bucket & 1)) << (msb-1);
+  return lower + ((1u << (msb-1)) - 1);
+}
+
+static float ticksPerUs () {
+#ifdef ARDUINO
+  return (float)getCpuFrequencyMhz();
+#else
+  return 1000.0f;
+#endif
+}
+
+void recordTiming(uint16_t slot, Stage stage, uint32_t ticks) {
+  TimingHistogram& h = histogramFor(slot, stage);
+  if (h.count == 0 || ticks < h.min) { h.min = ticks; }
+  h.buckets[bucketFor(ticks)]++;
+  h.total += ticks;
+  h.count++;
+  if (h.count >= timingWindow) { // Decay by half
+    for (uint8_t b=0; b<timingBuckets; b++) { h.buckets[b] /= 2; }
+    h.total /= 2;
+    h.count /= 2;
+    h.lastMin = h.min;
+    h.min = 0xffffffff;
+  }
+}
+
+bool timingSummary(uint16_t slot, Stage stage, TimingSummary& summary) {
+  const TimingHistogram& h = histogramFor(slot, stage);
+  if (h.count == 0) { return false; }
+  float scale = 1.0f / ticksPerUs();
+  uint32_t min = h.min;
+  if (h.lastMin != 0 && h.lastMin < min) { min = h.lastMin; }
+  uint32_t inBuckets = 0;
+  for (uint8_t b=0; b<timingBuckets; b++) { inBuckets += h.buckets[b]; } // Can be less than count after decays round down
+  uint32_t target = inBuckets - inBuckets/100;
+  uint32_t seen = 0;
+  uint8_t b = 0;
+  for (; b<timingBuckets-1; b++) {
+    seen += h.buckets[b];
+    if (seen >= target && seen > 0) { break; }
+  }
+  summary.samples = h.count;
+  summary.min = (float)min * scale;
+  summary.avg = (float)((double)h.total / (double)h.count) * scale;
+  summary.p99 = (float)bucketUpperEdge(b) * scale;
+  return true;
+}
+
+void resetTiming() {
+  for (uint8_t s=0; s<=timingStrips; s++) {
+    for (uint8_t t=0; t<stageCount; t++) { histograms[s][t] = TimingHistogram(); }
+  }
+}
+
+const char* stageName(Stage stage) {
+  switch (stage) {
+    case StageMode: return "mode";
+    case StageRing: return "ring";
+    case StagePalette: return "palette";
+    case StageOutput: return "output";
+    case StageShow: return "show";
+    case StageDmx: return "dmx";
+    case StageFrame: return "frame";
+    default: return "?";
+  }
+}
+
+// Prints a CSV line per stage that has samples, one line at a time so it works with Serial.println or puts
+void dumpTiming(void (*print) (const char* line)) {
+  char line[80];
+  print("strip,stage,samples,min_us,avg_us,p99_us");
+  for (uint8_t s=0; s<=timingStrips; s++) {
+    uint16_t slot = s == timingStrips ? timingGlobal : s;
+    for (uint8_t t=0; t<stageCount; t++) {
+      TimingSummary summary;
+      if (!timingSummary(slot, (Stage)t, summary)) { continue; }
+      char strip[8];
+      if (slot == timingGlobal) { snprintf(strip, sizeof(strip), "all"); }
+      else { snprintf(strip, sizeof(strip), "%d", s); }
+      snprintf(line, sizeof(line), "%s,%s,%lu,%.1f,%.1f,%.1f", strip, stageName((Stage)t), (unsigned long)summary.samples, summary.min, summary.avg, summary.p99);
+      print(line);
+    }
+  }
+}
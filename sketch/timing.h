@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+#define STAGE_TIMING // Comment out to compile the stage timers away to nothing
+
+// Parts of a frame that get timed separately
+enum Stage {
+  StageMode, // Mode kernel calculating the pixel scalars
+  StageRing, // Resolving a scrolling ring buffer back into strip order
+  StagePalette, // Rebuilding the palette lut when the palette inputs change
+  StageOutput, // Palette lookup, RGBW extraction and gamma into the output buffer
+  StageShow, // Sending the buffer to the strip
+  StageDmx, // Polling and parsing DMX
+  StageFrame, // Whole frame
+  stageCount
+};
+
+const uint8_t timingStrips = 8; // Strips beyond this share slots, by strip index modulo this, so their stats are only exact when rendered serially
+const uint16_t timingGlobal = 0xffff; // Slot for stages that aren't per strip
+const uint8_t timingBuckets = 64; // Two buckets per power of two of ticks
+const uint16_t timingWindow = 1024; // Samples before the histogram decays by half, so the stats follow recent frames
+
+// Raw timer ticks, CPU cycles on device and nanoseconds on host. Wraps, so only differences are meaningful
+#ifdef ARDUINO
+inline uint32_t timingNow () { return ESP.getCycleCount(); }
+#else
+inline uint32_t timingNow () {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+// Rolling stats for one stage in one slot, all times in microseconds
+struct TimingSummary {
+  uint32_t samples;
+  float min;
+  float avg;
+  float p99; // Upper edge of the histogram bucket holding the 99th percentile, so it errs high by up to ~40%
+};
+
+void recordTiming(uint16_t slot, Stage stage, uint32_t ticks);
+bool timingSummary(uint16_t slot, Stage stage, TimingSummary& summary);
+void resetTiming();
+const char* stageName(Stage stage);
+void dumpTiming(void (*print) (const char* line));
+
+// Times from construction to the end of the enclosing scope
+struct StageTimer {
+#ifdef STAGE_TIMING
+  uint16_t slot;
+  Stage stage;
+  uint32_t start;
+  StageTimer (uint16_t _slot, Stage _stage) {
+    slot = _slot;
+    stage = _stage;
+    start = timingNow();
+  }
+  ~StageTimer () { recordTiming(slot, stage, timingNow() - start); }
+#else
+  StageTimer (uint16_t, Stage) {}
+#endif
+};
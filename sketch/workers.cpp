@@ -0,0 +1,154 @@
+#include <atomic>
+#include "workers.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// The current batch. Jobs are claimed by bumping the index in batchClaim, which also carries the batch generation,
+// so a worker that wakes late can never claim a job from a batch it didn't read the job for
+static Job batchJob = nullptr;
+static void* batchContext = nullptr;
+static std::atomic<uint16_t> batchCount(0);
+static std::atomic<uint32_t> batchClaim(0); // Generation in the top 16 bits, next job index in the bottom 16
+static std::atomic<uint16_t> batchDone(0);
+static uint8_t workerCount = 0;
+static std::atomic<bool> stopping(false);
+
+static void finishedJob();
+
+static bool claimJob (uint16_t generation, uint16_t& index) {
+  uint32_t claim = batchClaim.load();
+  while (true) {
+    if ((claim >> 16) != generation || (claim & 0xffff) >= batchCount.load()) { return false; }
+    if (batchClaim.compare_exchange_weak(claim, claim + 1)) {
+      index = claim & 0xffff;
+      return true;
+    }
+  }
+}
+
+static void workThroughBatch () {
+  uint16_t generation = batchClaim.load() >> 16;
+  uint16_t index;
+  while (claimJob(generation, index)) {
+    batchJob(index, batchContext);
+    finishedJob();
+  }
+}
+
+// Publishes a new batch, batchClaim last so the job is visible to anyone who sees the new generation
+static void startBatch (Job job, void* context, uint16_t count) {
+  batchJob = job;
+  batchContext = context;
+  batchCount = count;
+  batchDone = 0;
+  batchClaim = ((batchClaim.load() >> 16) + 1) << 16;
+}
+
+#ifdef ARDUINO
+static TaskHandle_t workerTasks[maxWorkers];
+static TaskHandle_t callerTask = NULL;
+
+static void finishedJob () {
+  if (batchDone.fetch_add(1) + 1 == batchCount) { xTaskNotifyGive(callerTask); }
+}
+
+static void workerEntry (void*) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (stopping) { break; }
+    workThroughBatch();
+  }
+  xTaskNotifyGive(callerTask); // Tell stopWorkers() this one has finished with the batch state
+  vTaskDelete(NULL);
+}
+
+void startWorkers(uint8_t count) {
+  if (count > maxWorkers) { count = maxWorkers; }
+  stopping = false;
+  BaseType_t otherCore = xPortGetCoreID() == 0 ? 1 : 0;
+  for (uint8_t i=0; i<count; i++) {
+    // Alternate cores starting with the one the caller isn't on, the caller keeps its own core busy
+    xTaskCreatePinnedToCore(workerEntry, "worker", 4096, NULL, uxTaskPriorityGet(NULL), &workerTasks[i], (i % 2 == 0) ? otherCore : 1 - otherCore);
+  }
+  workerCount = count;
+}
+
+// Waits for every worker to exit, so their handles are never notified again and a restart can't race the old tasks
+void stopWorkers() {
+  callerTask = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyTake(pdTRUE, 0); // Clear any stale notification
+  stopping = true;
+  for (uint8_t i=0; i<workerCount; i++) { xTaskNotifyGive(workerTasks[i]); }
+  for (uint8_t i=0; i<workerCount; i++) { ulTaskNotifyTake(pdFALSE, portMAX_DELAY); } // One notification per exited worker
+  workerCount = 0;
+}
+
+void runParallel(Job job, void* context, uint16_t count) {
+  if (count == 0) { return; }
+  callerTask = xTaskGetCurrentTaskHandle(); // Before the batch starts, in case a worker that's already awake finishes it
+  ulTaskNotifyTake(pdTRUE, 0); // Clear any stale notification
+  startBatch(job, context, count);
+  for (uint8_t i=0; i<workerCount && i+1<count; i++) { xTaskNotifyGive(workerTasks[i]); }
+  workThroughBatch();
+  while (batchDone.load() < batchCount) { ulTaskNotifyTake(pdTRUE, portMAX_DELAY); }
+}
+#else
+static std::thread workerThreads[maxWorkers];
+static std::mutex batchMutex;
+static std::condition_variable batchStarted;
+static std::condition_variable batchFinished;
+
+static void finishedJob () {
+  if (batchDone.fetch_add(1) + 1 == batchCount) {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    batchFinished.notify_one();
+  }
+}
+
+static void workerEntry () {
+  uint16_t generation = batchClaim.load() >> 16;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(batchMutex);
+      batchStarted.wait(lock, [&] { return stopping || (batchClaim.load() >> 16) != generation; });
+      if (stopping) { return; }
+      generation = batchClaim.load() >> 16;
+    }
+    workThroughBatch();
+  }
+}
+
+void startWorkers(uint8_t count) {
+  if (count > maxWorkers) { count = maxWorkers; }
+  stopping = false;
+  for (uint8_t i=0; i<count; i++) { workerThreads[i] = std::thread(workerEntry); }
+  workerCount = count;
+}
+
+void stopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    stopping = true;
+  }
+  batchStarted.notify_all();
+  for (uint8_t i=0; i<workerCount; i++) { workerThreads[i].join(); }
+  workerCount = 0;
+}
+
+void runParallel(Job job, void* context, uint16_t count) {
+  if (count == 0) { return; }
+  {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    startBatch(job, context, count);
+  }
+  batchStarted.notify_all();
+  workThroughBatch();
+  std::unique_lock<std::mutex> lock(batchMutex);
+  batchFinished.wait(lock, [&] { return batchDone.load() >= batchCount; });
+}
+#endif
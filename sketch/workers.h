@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+// Small pool of workers for running independent jobs, such as one updateStrip() per strip, in parallel.
+// The calling thread works through the jobs too, and runParallel() only returns once every job is done
+typedef void (*Job) (uint16_t index, void* context);
+
+const uint8_t maxWorkers = 7; // Plus the caller, enough for a job per output on the 8 way I2S method
+
+void startWorkers(uint8_t count);
+void stopWorkers();
+void runParallel(Job job, void* context, uint16_t count);
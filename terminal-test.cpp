@@ -2,13 +2,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <math.h>
-#include <sys/time.h>
 #include <unistd.h>
 #include <termios.h>
 #include <string.h>
 
 #include "sketch/modes.h"
 #include "sketch/palettes.h"
+#include "sketch/gradients.h"
+#include "sketch/timing.h"
+#include "sketch/scheduler.h"
 
 struct termios orig_termios;
 void disable_non_blocking_input() {
@@ -33,7 +35,30 @@ void setPixel1 (uint16_t index, Rgb color) {
 PixelStrip pixelStrip1(pixelCount1, setPixel1);
 Controls controls1(Rgb(0.0f,0.0f,0.6f),Rgb(1.0f,1.0f,1.0f));
 
+int timingRow = 4;
+void printTimingLine (const char* line) {
+    printf("\x1b[%d;%dH%s\x1b[K", timingRow++, 0, line);
+}
+
+void printStatus (const char* line) {
+    printf("\x1b[%d;%dH%s\x1b[K", 3, 0, line);
+}
+
+// The whole file is one gradient, in the same pos:rrggbb[:blend] format as the u command, over any number of lines
+bool loadGradientFile (uint8_t slot, const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) { return false; }
+  char text[1024] = {0};
+  size_t length = fread(text, 1, sizeof(text) - 1, file);
+  bool complete = feof(file) != 0;
+  fclose(file);
+  text[length] = '\0';
+  return complete && setGradient(slot, text);
+}
+
 void parseInput (Controls& controls, char* data) { // For testing
+  if (data[0] == 't') { timingRow = 4; dumpTiming(printTimingLine); } // Stage timings as CSV below the strip
+  if (data[0] == 'T') { resetTiming(); }
   if (data[0] == 'm') { controls.mode = atoi(&data[1]); }
   if (data[0] == 'p') { controls.palette = atoi(&data[1]); }
   if (data[0] == 'c') { controls.control = ((float)atoi(&data[1]))/255; }
@@ -44,20 +69,28 @@ void parseInput (Controls& controls, char* data) { // For testing
   if (data[0] == 'R') { controls.fore.red = ((float)atoi(&data[1]))/255; }
   if (data[0] == 'G') { controls.fore.green = ((float)atoi(&data[1]))/255; }
   if (data[0] == 'B') { controls.fore.blue = ((float)atoi(&data[1]))/255; }
+  if (data[0] == 'u') { // u<slot> pos:rrggbb[:blend] ... uploads gradient palette 200+slot
+    const char* space = strchr(data, ' ');
+    printStatus(setGradient(atoi(&data[1]), (space == nullptr) ? "" : space + 1) ? "Gradient set" : "Bad gradient");
+  }
 }
 
-int main () {
+// Any gradient files given on the command line are loaded into slots 0 upwards, so palettes 200 upwards
+int main (int argc, char** argv) {
   unsigned long timeMs = 0;
   unsigned int frameIntervalMs = 10;
   unsigned int numPixels = 32;
   char line[100];
-  timeval timeval;
+  FrameScheduler scheduler(100);
   char input_buffer[256] = {0};
   unsigned int input_index = 0;
   char key;
   int running = 1;
   enable_non_blocking_input();
   printf("\x1b[2J\x1b[H");
+  for (int i=1; i<argc && i<=gradientSlots; i++) {
+    if (!loadGradientFile(i - 1, argv[i])) { printStatus("Bad gradient file"); }
+  }
   while (running) {
     fflush(stdout);
     fflush(stdin);
@@ -77,9 +110,8 @@ int main () {
       }
       if (key == 'q' || key == 'Q') { running = 0; }
     }
-    gettimeofday(&timeval, NULL);
-    updateStrip(controls1, pixelStrip1, timeval.tv_usec);
-    usleep(10000);
+    updateStrip(controls1, pixelStrip1, scheduler.beginFrame());
+    scheduler.waitForNextFrame();
   }
   return 0;
-}
\ No newline at end of file
+}